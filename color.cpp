@@ -3,11 +3,37 @@
    ESP32 Color Composite Dashboard with Glow Plug
    -----------------------------------------------------------
    Features:
-   - Each metric (oil, coolant, fuel) has its own function
+   - Each metric (oil, coolant, fuel) is a channel that layout widgets draw from
    - Reads sensors, calculates values, and draws gauge/icon
    - Flashing background for critical values
    - Glow plug control with countdown timer and icon
    - No afterglow
+   - Bars and values ease toward new readings; only changed columns are redrawn
+   - Peak-hold marker on the coolant bar and low-hold marker on the fuel bar
+   - Coolant and fuel figures in large seven-segment digits; only toggled segments are redrawn
+   - Labels and alarm texts in a proportional face, cached as one-blit runs ("font" times it)
+   - Several pages (gauges, trip, diagnostics, raw sensors) with cached static layers
+   - Night mode: ambient light sensor dims the palette with hysteresis
+   - Audible alarms on a piezo, sequenced by a hardware timer
+   - Binary telemetry stream (COBS framed, CRC-16) on a dedicated UART
+   - Framebuffer mirroring over the telemetry link (XOR delta + RLE tiles)
+   - Serial console (115200 baud, type "help") for live calibration, stats and tests
+   - Boot self-test of ADC, render, icon blit and glow output against stored baselines
+   - Optional ILI9341/ST7789 SPI TFT mirror, updated by DMA in dirty rectangles
+   - Power-loss-safe checkpoints of readings, trip, engine hours and calibration
+   - Trip ends on refuelling or on the console ("trip reset")
+   - Per-subsystem heartbeat watchdog: a stall forces the glow plug off, records the
+     active probe and reboots; the record is shown on the next boot
+   - Memory report (heap low-water, largest block, task stack headroom, boot arena use)
+     on the diagnostics page, the console ("mem") and the telemetry stream
+   - Frame-time histogram (log2 buckets) with traces of frames over budget, on a page
+     and on the console ("hist")
+   - Optional attribute video (ATTR_VIDEO): 1bpp bitmap with 8x8 color cells scanned
+     out by our own PAL generator, about a seventh of the frame memory; peak markers
+     and the glow icon are scanout-time sprites there
+   - Optional second composite screen (DUAL_VIDEO) with trip and diagnostic figures
+   - Optional PSRAM frames (PSRAM_FRAME) on WROVER modules, prefetched into an internal
+     RAM row ring ahead of scanout
 
   Libraries Required:
   -------------------
@@ -39,31 +65,576 @@
     Read with analogRead(), mapped to liters
 
   - Glow plug button: GPIO 15 (digital input, active LOW)
-    Press button to start glow plug sequence
+    Short press starts the glow plug sequence
+    Long press switches to the next page
+
+  - Ambient light sensor: GPIO 34 (analog input, LDR divider, brighter = higher)
+    Selects the day or night palette
 
   - Glow plug MOSFET control: GPIO 16 (digital output)
     HIGH = turn on glow plug
     LOW  = turn off glow plug
+    Fit a gate pull-down: during a watchdog reset the pin floats
+
+  - Piezo buzzer: GPIO 4 (LEDC PWM output)
+    Driven by LEDC channel 0; steps sequenced by hardware timer 1.
+    Neither is used by the composite output on the DAC pins.
+
+  - Optional SPI TFT (ILI9341 or ST7789, set tftEnabled): VSPI
+    SCLK GPIO 18, MOSI GPIO 23, CS GPIO 5, DC GPIO 27, RST GPIO 14
+
+  - Ignition sense (optional, set ignitionPin; GPIO 35 suggested): digital input,
+    divider from switched ignition. Falling edge = ignition cut; the ESP32 must be
+    held up (capacitor) for ~50 ms. Leave it -1 unless the divider is fitted: an
+    open input floats and every stray edge costs a flash write and an erase.
+
+  - Telemetry UART TX: GPIO 13 (UART2, 921600 baud, TX only)
+    Connect to a USB-serial adapter; see "Telemetry" for the frame format.
 
   Other Notes:
   ------------
   - TV output: connect ESP32 DAC pins (usually GPIO 25 or 26) to TV composite input with proper resistor network if needed.
+    With ATTR_VIDEO the signal is on GPIO 25 (I2S0 driving the built-in DAC);
+    DUAL_VIDEO adds the second screen on GPIO 26.
   - Ensure proper power supply for ESP32 and glow plug circuit (MOSFET rated for current).
   - Screen will display:
       - Oil, coolant, and fuel icons with color-coded gauges
       - Flashing background if any value is critical
       - Glow plug countdown when activated
-  - Each metric has its own function for reading sensor and drawing the gauge for modularity.
+  - Sensors are sampled by readSensors() every sensorPeriodUs; the gauge screen is described by a binary
+    layout (see "Layout") that can be flashed to a "layout" data partition per vehicle.
+  - Partition table needs two extra data partitions: "layout" (4 KB) and "ckpt" (8 KB, two sectors).
+  - The screen is retained: only the parts of a gauge that changed since the last frame are repainted.
 
   ===================================================================
 */
 
+// 1 = our own composite scanout from a 1bpp bitmap with 8x8 color
+// attributes (see "Attribute video") instead of CompositeGraphics.
+#ifndef ATTR_VIDEO
+#define ATTR_VIDEO 0
+#endif
+// 1 (with ATTR_VIDEO) = a second composite screen on GPIO 26
+#ifndef DUAL_VIDEO
+#define DUAL_VIDEO 0
+#endif
+// 1 (with ATTR_VIDEO, WROVER modules) = frames in PSRAM, scanned out
+// through an internal RAM row ring
+#ifndef PSRAM_FRAME
+#define PSRAM_FRAME 0
+#endif
+#if DUAL_VIDEO && !ATTR_VIDEO
+#error "DUAL_VIDEO needs ATTR_VIDEO"
+#endif
+#if PSRAM_FRAME && !ATTR_VIDEO
+#error "PSRAM_FRAME needs ATTR_VIDEO"
+#endif
+
 #include <CompositeGraphics.h>
 #include <CompositeVideo.h>
 #include <Arduino.h>
+#include <esp_partition.h>
+#include <Preferences.h>
+#include <driver/spi_master.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#if ATTR_VIDEO
+#include <driver/i2s.h>
+#endif
+
+#if ATTR_VIDEO
+// -------------------------------------------------------------------
+// Attribute video
+// The frame is a 1bpp bitmap plus one attribute byte per 8x8 cell:
+// background palette index in the high nibble, foreground in the low
+// one. 128x96 takes 1536 + 192 bytes instead of a byte per pixel
+// (12288), and recoloring something is a write to its cells'
+// attributes (recolor()).
+//
+// Drawing in a cell's background color clears pixels; any other color
+// sets them and becomes the cell's foreground. fillScreen() sets every
+// cell's background. Each cell shows two colors, so layouts keep
+// differently colored things in different cells (snapToCell()).
+//
+// Scanout runs on core 0: a task builds each PAL line as DAC samples
+// and hands it to I2S0, which plays it through the built-in DAC on
+// GPIO 25 by DMA. Samples run at four times the color subcarrier, so
+// every palette entry is stored as four samples (one per subcarrier
+// quarter), for even and odd lines since PAL flips V every line. One
+// field of 312 lines is sent per frame, without interlace.
+//
+// Sprites are 16x16, one color each, and are laid over the bitmap by
+// the line generator, so moving, hiding or recoloring one never touches
+// the frame. At most attrSpritesPerLine are drawn on a line (lower slots
+// first, later ones on top). lineCyclesMax records the slowest line
+// built, to check against the 64 us line.
+//
+// With DUAL_VIDEO there are two frames and the I2S runs stereo: every
+// 32-bit sample pair carries one sample for each DAC, so both screens
+// come out of the same DMA stream with the same timing, and each line
+// is built for both before it is queued. select() picks the frame that
+// drawing goes to. Memory for two screens: 2 x 1728 B of frames and a
+// 4544 B line buffer (2 x 2272 mono), plus the driver's two DMA buffers
+// of the same size.
+//
+// With PSRAM_FRAME the frames live in PSRAM and only a ring of
+// attrPrefetchRows rows (bitmap and attribute bytes) per screen is kept
+// in internal RAM. Reading PSRAM from the line generator stalls it
+// whenever the cache misses or core 1 is busy on the SPI bus, so a
+// prefetch task, below the scanout task on core 0, copies the rows the
+// next lines need into the ring while the scanout task waits on I2S.
+// Row sequence numbers (field * height + row) tag the slots, so a row
+// copied in an earlier field is never shown. A row that is not in the
+// ring when its line is built counts in prefetchUnderruns and is read
+// from PSRAM directly. The ESP32 has no memory-to-memory DMA, so the
+// copy is done by the CPU; a deeper ring gives the task more slack.
+const int attrScreens        = DUAL_VIDEO ? 2 : 1;
+const int attrSampleHz       = 17734475;  // 4 x 4.43361875 MHz
+const int attrLineSamples    = 1136;      // 64 us
+const int attrHalfLine       = attrLineSamples / 2;
+const int attrSyncSamples    = 83;        // 4.7 us
+const int attrBroadSamples   = 484;       // 27.3 us vertical sync pulse
+const int attrEqualSamples   = 42;        // 2.35 us equalizing pulse
+const int attrBurstStart     = 99;        // 5.6 us
+const int attrBurstSamples   = 40;        // 10 subcarrier cycles
+const int attrActiveStart    = 186;       // 10.5 us
+const int attrActiveSamples  = 922;       // 52 us
+const int attrPixelSamples   = 6;
+const int attrFieldLines     = 312;
+const int attrBroadLines     = 3;
+const int attrEqualLines     = 2;
+const int attrFirstLine      = 70;        // line showing screen row 0
+const int attrLineRepeat     = 2;         // lines per screen row
+const uint8_t attrLevelSync  = 0;         // DAC codes for 0, 0.3 and 1 V at the TV input
+const uint8_t attrLevelBlank = 23;
+const uint8_t attrLevelWhite = 77;
+const float attrBurstUV      = 0.151f;    // burst at 180 +/- 45 degrees, 0.3 Vpp
+const int attrMaxSprites     = 8;
+const int attrSpritesPerLine = 4;
+const int attrSpriteSize     = 16;
+const int attrPrefetchRows   = 8;         // ring depth; rows are read up to depth - 1 ahead
+
+// 5x7 glyphs for ' ' to 'Z', one byte per column, top pixel in bit 0.
+// Lower case prints as upper case.
+const uint8_t attrFont[] PROGMEM = {
+  0x00,0x00,0x00,0x00,0x00, 0x00,0x00,0x5F,0x00,0x00, 0x00,0x07,0x00,0x07,0x00, 0x14,0x7F,0x14,0x7F,0x14,
+  0x24,0x2A,0x7F,0x2A,0x12, 0x23,0x13,0x08,0x64,0x62, 0x36,0x49,0x56,0x20,0x50, 0x00,0x08,0x07,0x03,0x00,
+  0x00,0x1C,0x22,0x41,0x00, 0x00,0x41,0x22,0x1C,0x00, 0x2A,0x1C,0x7F,0x1C,0x2A, 0x08,0x08,0x3E,0x08,0x08,
+  0x00,0x80,0x70,0x30,0x00, 0x08,0x08,0x08,0x08,0x08, 0x00,0x00,0x60,0x60,0x00, 0x20,0x10,0x08,0x04,0x02,
+  0x3E,0x51,0x49,0x45,0x3E, 0x00,0x42,0x7F,0x40,0x00, 0x72,0x49,0x49,0x49,0x46, 0x21,0x41,0x49,0x4D,0x33,
+  0x18,0x14,0x12,0x7F,0x10, 0x27,0x45,0x45,0x45,0x39, 0x3C,0x4A,0x49,0x49,0x31, 0x41,0x21,0x11,0x09,0x07,
+  0x36,0x49,0x49,0x49,0x36, 0x46,0x49,0x49,0x29,0x1E, 0x00,0x00,0x14,0x00,0x00, 0x00,0x40,0x34,0x00,0x00,
+  0x00,0x08,0x14,0x22,0x41, 0x14,0x14,0x14,0x14,0x14, 0x00,0x41,0x22,0x14,0x08, 0x02,0x01,0x59,0x09,0x06,
+  0x3E,0x41,0x5D,0x59,0x4E, 0x7C,0x12,0x11,0x12,0x7C, 0x7F,0x49,0x49,0x49,0x36, 0x3E,0x41,0x41,0x41,0x22,
+  0x7F,0x41,0x41,0x41,0x3E, 0x7F,0x49,0x49,0x49,0x41, 0x7F,0x09,0x09,0x09,0x01, 0x3E,0x41,0x41,0x51,0x73,
+  0x7F,0x08,0x08,0x08,0x7F, 0x00,0x41,0x7F,0x41,0x00, 0x20,0x40,0x41,0x3F,0x01, 0x7F,0x08,0x14,0x22,0x41,
+  0x7F,0x40,0x40,0x40,0x40, 0x7F,0x02,0x1C,0x02,0x7F, 0x7F,0x04,0x08,0x10,0x7F, 0x3E,0x41,0x41,0x41,0x3E,
+  0x7F,0x09,0x09,0x09,0x06, 0x3E,0x41,0x51,0x21,0x5E, 0x7F,0x09,0x19,0x29,0x46, 0x26,0x49,0x49,0x49,0x32,
+  0x03,0x01,0x7F,0x01,0x03, 0x3F,0x40,0x40,0x40,0x3F, 0x1F,0x20,0x40,0x20,0x1F, 0x3F,0x40,0x38,0x40,0x3F,
+  0x63,0x14,0x08,0x14,0x63, 0x03,0x04,0x78,0x04,0x03, 0x61,0x59,0x49,0x4D,0x43,
+};
+const int attrGlyphWidth = 5, attrGlyphHeight = 7, attrCharAdvance = 6;
+
+struct AttrSprite {
+  uint16_t rows[attrSpriteSize];  // leftmost pixel in bit 15
+  int16_t x, y;
+  uint8_t index;
+  bool visible;
+};
+
+struct AttrFrame {
+  uint8_t *bitmap;                 // cols bytes per row, leftmost pixel in bit 7
+  uint8_t *attrs;                  // cols bytes per cell row
+  AttrSprite sprites[attrMaxSprites];
+#if PSRAM_FRAME
+  uint8_t *ring;                   // per slot: cols bitmap bytes, then cols attribute bytes
+  volatile uint32_t ringSeq[attrPrefetchRows];  // row sequence number held by each slot
+#endif
+};
+
+class AttrGraphics {
+public:
+  uint8_t colorIndex[256];  // color value -> palette index, filled by the sketch
+  volatile uint32_t lineCyclesMax = 0;  // all screens' share of a line
+  volatile uint32_t prefetchUnderruns = 0;
+
+  AttrGraphics(int width, int height)
+    : width(width), height(height), cols(width / 8), rows(height / 8) {}
+
+  void begin();
+  void select(int screen) { frame = &frames[screen]; }
+  void setPaletteEntry(uint8_t index, uint8_t color, uint8_t r, uint8_t g, uint8_t b);
+  void setFont(int) {}
+  void setHue(uint16_t color) { hue = color; }
+  void setCursor(int x, int y) { cursorX = x; cursorY = y; }
+  void print(const char *text);
+  void print(const String &text) { print(text.c_str()); }
+  void print(int value) { print(String(value)); }
+  void fillScreen(uint16_t color);
+  void fillRect(int x, int y, int w, int h, uint16_t color);
+  void drawRect(int x, int y, int w, int h, uint16_t color);
+  void drawBitmap(int x, int y, const unsigned char *bitmap, int w, int h, uint16_t color);
+  void recolor(int x, int y, int w, int h, uint16_t color);
+  void remapColors(const uint8_t lut[256]);
+  void expandRow(int y, char *out) const;  // screen 0
+  size_t frameBytes() const { return cols * height + cols * rows; }
+  size_t lineBytes() const { return attrLineSamples * attrScreens * 2; }
+  size_t ringBytes() const { return PSRAM_FRAME ? attrPrefetchRows * cols * 2 : 0; }
+
+  void setSprite(int slot, const unsigned char *bitmap, uint16_t color);
+  void moveSprite(int slot, int x, int y) { frame->sprites[slot].x = x; frame->sprites[slot].y = y; }
+  void hideSprite(int slot) { frame->sprites[slot].visible = false; }
+  void hideSprites() { for(AttrSprite &sprite : frame->sprites) sprite.visible = false; }
+
+  // Builds line `line` of the field for every screen into the line
+  // buffer (lineBytes() long) and times it into lineCyclesMax.
+  const uint16_t *buildLines(int line);
+
+private:
+  int width, height, cols, rows;
+  AttrFrame frames[attrScreens] = {};
+  AttrFrame *frame = frames;       // drawing target
+  uint16_t *lineBuffer = NULL;
+  uint8_t paletteColor[16];        // color value each entry stands for
+  uint16_t pattern[2][16][4];      // [line parity][entry][subcarrier quarter]
+  uint16_t burst[2][4];
+  uint16_t hue = 0;
+  int cursorX = 0, cursorY = 0;
+  uint32_t field = 0;              // fields sent, for row sequence numbers
+  volatile uint32_t nextSeq = 0;   // first row the prefetch task should have ready
+  TaskHandle_t prefetchHandle = NULL;
+
+  void plot(int x, int y, uint8_t index);
+  int spritesOnRow(const AttrFrame &f, int row, const AttrSprite *found[attrSpritesPerLine]) const;
+  void buildLine(const AttrFrame &f, int screen, int line);
+  void renderRow(const AttrFrame &f, int screen, int row, int parity);
+  void rowSource(const AttrFrame &f, int row, const uint8_t *&bits, const uint8_t *&attr);
+  static void scanoutTask(void *self);
+  static void prefetchTask(void *self);
+};
+
+// Buffer position of sample s of a screen. Mono output plays 16-bit
+// pairs with the halves swapped; stereo puts screen 0 (DAC 1, GPIO 25)
+// in the high half of each pair and screen 1 (DAC 2, GPIO 26) in the low.
+inline int sampleIndex(int s, int screen) {
+  return attrScreens == 1 ? s ^ 1 : (s << 1) | (screen ^ 1);
+}
+
+void fillSamples(uint16_t *out, int screen, int from, int to, uint8_t level) {
+  for(int s = from; s < to; s++) out[sampleIndex(s, screen)] = level << 8;
+}
+
+// Y, U, V scaled so 1.0 is white; quarter k is at subcarrier phase k * 90.
+void setChromaPattern(uint16_t out[4], float y, float u, float v) {
+  const float level[4] = { y + v, y + u, y - v, y - u };
+  for(int k = 0; k < 4; k++){
+    int code = attrLevelBlank + (int)lroundf(level[k] * (attrLevelWhite - attrLevelBlank));
+    out[k] = constrain(code, attrLevelSync + 1, 255) << 8;
+  }
+}
+
+void AttrGraphics::begin() {
+  const uint32_t frameCaps = PSRAM_FRAME ? MALLOC_CAP_SPIRAM : MALLOC_CAP_INTERNAL;
+  for(AttrFrame &f : frames){
+    f.bitmap = (uint8_t *)heap_caps_calloc(cols * height, 1, frameCaps);
+    f.attrs  = (uint8_t *)heap_caps_calloc(cols * rows, 1, frameCaps);
+#if PSRAM_FRAME
+    f.ring   = (uint8_t *)heap_caps_malloc(ringBytes(), MALLOC_CAP_INTERNAL);
+    for(int slot = 0; slot < attrPrefetchRows; slot++) f.ringSeq[slot] = UINT32_MAX;
+#endif
+  }
+  lineBuffer = (uint16_t *)heap_caps_malloc(lineBytes(), MALLOC_CAP_INTERNAL);
+  for(int parity = 0; parity < 2; parity++)
+    setChromaPattern(burst[parity], 0, -attrBurstUV, parity ? -attrBurstUV : attrBurstUV);
+
+  i2s_config_t config = {};
+  config.mode                 = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_DAC_BUILT_IN);
+  config.sample_rate          = attrSampleHz;
+  config.bits_per_sample      = I2S_BITS_PER_SAMPLE_16BIT;
+  config.channel_format       = DUAL_VIDEO ? I2S_CHANNEL_FMT_RIGHT_LEFT : I2S_CHANNEL_FMT_ONLY_RIGHT;
+  config.communication_format = I2S_COMM_FORMAT_STAND_MSB;
+  config.dma_buf_count        = 2;
+  config.dma_buf_len          = attrLineSamples;
+  config.use_apll             = true;
+  i2s_driver_install(I2S_NUM_0, &config, 0, NULL);
+  i2s_set_pin(I2S_NUM_0, NULL);
+  i2s_set_dac_mode(DUAL_VIDEO ? I2S_DAC_CHANNEL_BOTH_EN : I2S_DAC_CHANNEL_RIGHT_EN);  // GPIO 25 (and 26)
+#if PSRAM_FRAME
+  xTaskCreatePinnedToCore(prefetchTask, "prefetch", 2048, this, configMAX_PRIORITIES - 3, &prefetchHandle, 0);
+#endif
+  xTaskCreatePinnedToCore(scanoutTask, "scanout", 2048, this, configMAX_PRIORITIES - 2, NULL, 0);
+}
+
+void AttrGraphics::setPaletteEntry(uint8_t index, uint8_t color, uint8_t r, uint8_t g, uint8_t b) {
+  paletteColor[index] = color;
+  float y = (0.299f * r + 0.587f * g + 0.114f * b) / 255;
+  float u = 0.493f * (b / 255.0f - y);
+  float v = 0.877f * (r / 255.0f - y);
+  setChromaPattern(pattern[0][index], y, u, v);
+  setChromaPattern(pattern[1][index], y, u, -v);
+}
+
+void AttrGraphics::plot(int x, int y, uint8_t index) {
+  if(x < 0 || y < 0 || x >= width || y >= height) return;
+  uint8_t &attr = frame->attrs[(y >> 3) * cols + (x >> 3)];
+  uint8_t &bits = frame->bitmap[y * cols + (x >> 3)];
+  uint8_t mask = 0x80 >> (x & 7);
+  if(index == attr >> 4){
+    bits &= ~mask;
+  } else {
+    attr = (attr & 0xF0) | index;
+    bits |= mask;
+  }
+}
+
+void AttrGraphics::fillScreen(uint16_t color) {
+  uint8_t index = colorIndex[(uint8_t)color];
+  memset(frame->bitmap, 0, cols * height);
+  memset(frame->attrs, index << 4 | index, cols * rows);
+}
+
+// A byte of the bitmap at a time; the cell's attribute decides set or clear.
+void AttrGraphics::fillRect(int x, int y, int w, int h, uint16_t color) {
+  uint8_t index = colorIndex[(uint8_t)color];
+  int x0 = max(x, 0), x1 = min(x + w, width);
+  int y0 = max(y, 0), y1 = min(y + h, height);
+  if(x0 >= x1) return;
+  for(int py = y0; py < y1; py++){
+    uint8_t *bits = frame->bitmap + py * cols;
+    uint8_t *attr = frame->attrs + (py >> 3) * cols;
+    for(int c = x0 >> 3; c * 8 < x1; c++){
+      int from = max(x0 - c * 8, 0), to = min(x1 - c * 8, 8);
+      uint8_t mask = (0xFF >> from) & ~(0xFF >> to);
+      if(index == attr[c] >> 4){
+        bits[c] &= ~mask;
+      } else {
+        attr[c] = (attr[c] & 0xF0) | index;
+        bits[c] |= mask;
+      }
+    }
+  }
+}
+
+void AttrGraphics::drawRect(int x, int y, int w, int h, uint16_t color) {
+  fillRect(x, y, w, 1, color);
+  fillRect(x, y + h - 1, w, 1, color);
+  fillRect(x, y, 1, h, color);
+  fillRect(x + w - 1, y, 1, h, color);
+}
+
+// Bitmaps are PROGMEM rows of w/8 bytes; only set bits are drawn.
+void AttrGraphics::drawBitmap(int x, int y, const unsigned char *bitmap, int w, int h, uint16_t color) {
+  uint8_t index = colorIndex[(uint8_t)color];
+  for(int row = 0; row < h; row++){
+    for(int col = 0; col < w; col++){
+      if(pgm_read_byte(bitmap + row * (w / 8) + col / 8) & (0x80 >> (col & 7))) plot(x + col, y + row, index);
+    }
+  }
+}
+
+void AttrGraphics::print(const char *text) {
+  uint8_t index = colorIndex[(uint8_t)hue];
+  for(; *text; text++, cursorX += attrCharAdvance){
+    char c = toupper(*text);
+    if(c < ' ' || c > 'Z') c = '?';
+    const uint8_t *glyph = attrFont + (c - ' ') * attrGlyphWidth;
+    for(int col = 0; col < attrGlyphWidth; col++){
+      uint8_t bits = pgm_read_byte(glyph + col);
+      for(int row = 0; row < attrGlyphHeight; row++){
+        if(bits & (1 << row)) plot(cursorX + col, cursorY + row, index);
+      }
+    }
+  }
+}
+
+void AttrGraphics::recolor(int x, int y, int w, int h, uint16_t color) {
+  uint8_t index = colorIndex[(uint8_t)color];
+  for(int cy = max(y, 0) >> 3; cy * 8 < min(y + h, height); cy++){
+    for(int cx = max(x, 0) >> 3; cx * 8 < min(x + w, width); cx++){
+      uint8_t &attr = frame->attrs[cy * cols + cx];
+      attr = (attr & 0xF0) | index;
+    }
+  }
+}
+
+// Passes every attribute of every screen through a color-value remap table.
+void AttrGraphics::remapColors(const uint8_t lut[256]) {
+  uint8_t map[16];
+  for(int i = 0; i < 16; i++) map[i] = colorIndex[lut[paletteColor[i]]];
+  for(AttrFrame &f : frames){
+    for(int i = 0; i < cols * rows; i++) f.attrs[i] = map[f.attrs[i] >> 4] << 4 | map[f.attrs[i] & 15];
+    for(AttrSprite &sprite : f.sprites) sprite.index = map[sprite.index];
+  }
+}
+
+// Copies a 16x16 PROGMEM bitmap (2 bytes per row) and shows the sprite.
+void AttrGraphics::setSprite(int slot, const unsigned char *bitmap, uint16_t color) {
+  AttrSprite &sprite = frame->sprites[slot];
+  for(int row = 0; row < attrSpriteSize; row++)
+    sprite.rows[row] = pgm_read_byte(bitmap + row * 2) << 8 | pgm_read_byte(bitmap + row * 2 + 1);
+  sprite.index = colorIndex[(uint8_t)color];
+  sprite.visible = true;
+}
+
+int AttrGraphics::spritesOnRow(const AttrFrame &f, int row, const AttrSprite *found[attrSpritesPerLine]) const {
+  int count = 0;
+  for(const AttrSprite &sprite : f.sprites){
+    if(!sprite.visible || row < sprite.y || row >= sprite.y + attrSpriteSize) continue;
+    found[count++] = &sprite;
+    if(count == attrSpritesPerLine) break;
+  }
+  return count;
+}
+
+void AttrGraphics::expandRow(int y, char *out) const {
+  const AttrFrame &f = frames[0];
+  const uint8_t *bits = f.bitmap + y * cols;
+  const uint8_t *attr = f.attrs + (y >> 3) * cols;
+  for(int x = 0; x < width; x++){
+    uint8_t a = attr[x >> 3];
+    out[x] = paletteColor[(bits[x >> 3] & (0x80 >> (x & 7))) ? a & 15 : a >> 4];
+  }
+
+  const AttrSprite *found[attrSpritesPerLine];
+  int count = spritesOnRow(f, y, found);
+  for(int i = 0; i < count; i++){
+    uint16_t spriteBits = found[i]->rows[y - found[i]->y];
+    for(int px = 0; spriteBits; px++, spriteBits <<= 1){
+      int x = found[i]->x + px;
+      if((spriteBits & 0x8000) && x >= 0 && x < width) out[x] = paletteColor[found[i]->index];
+    }
+  }
+}
+
+void AttrGraphics::renderRow(const AttrFrame &f, int screen, int row, int parity) {
+  const int left = attrActiveStart + (attrActiveSamples - width * attrPixelSamples) / 2;
+  int s = left;
+  const uint8_t *bits, *attr;
+  rowSource(f, row, bits, attr);
+  for(int c = 0; c < cols; c++){
+    const uint16_t *fg = pattern[parity][attr[c] & 15];
+    const uint16_t *bg = pattern[parity][attr[c] >> 4];
+    uint8_t b = bits[c];
+    for(int px = 0; px < 8; px++, b <<= 1){
+      const uint16_t *p = (b & 0x80) ? fg : bg;
+      for(int k = 0; k < attrPixelSamples; k++, s++) lineBuffer[sampleIndex(s, screen)] = p[s & 3];
+    }
+  }
+
+  const AttrSprite *found[attrSpritesPerLine];
+  int count = spritesOnRow(f, row, found);
+  for(int i = 0; i < count; i++){
+    const uint16_t *p = pattern[parity][found[i]->index];
+    uint16_t spriteBits = found[i]->rows[row - found[i]->y];
+    for(int px = 0; spriteBits; px++, spriteBits <<= 1){
+      int x = found[i]->x + px;
+      if(!(spriteBits & 0x8000) || x < 0 || x >= width) continue;
+      s = left + x * attrPixelSamples;
+      for(int k = 0; k < attrPixelSamples; k++, s++) lineBuffer[sampleIndex(s, screen)] = p[s & 3];
+    }
+  }
+}
+
+// The ring slot holding the row this field, or the frame itself.
+void AttrGraphics::rowSource(const AttrFrame &f, int row, const uint8_t *&bits, const uint8_t *&attr) {
+#if PSRAM_FRAME
+  uint32_t seq = field * height + row;
+  int slot = seq % attrPrefetchRows;
+  if(f.ringSeq[slot] == seq){
+    bits = f.ring + slot * cols * 2;
+    attr = bits + cols;
+    return;
+  }
+  prefetchUnderruns++;
+#endif
+  bits = f.bitmap + row * cols;
+  attr = f.attrs + (row >> 3) * cols;
+}
+
+void AttrGraphics::buildLine(const AttrFrame &f, int screen, int line) {
+  uint16_t *out = lineBuffer;
+  if(line < attrBroadLines + attrEqualLines){
+    int pulse = (line < attrBroadLines) ? attrBroadSamples : attrEqualSamples;
+    for(int half = 0; half < attrLineSamples; half += attrHalfLine){
+      fillSamples(out, screen, half, half + pulse, attrLevelSync);
+      fillSamples(out, screen, half + pulse, half + attrHalfLine, attrLevelBlank);
+    }
+    return;
+  }
+  int parity = line & 1;
+  fillSamples(out, screen, 0, attrSyncSamples, attrLevelSync);
+  fillSamples(out, screen, attrSyncSamples, attrLineSamples, attrLevelBlank);
+  for(int s = attrBurstStart; s < attrBurstStart + attrBurstSamples; s++)
+    out[sampleIndex(s, screen)] = burst[parity][s & 3];
+  int row = (line - attrFirstLine) / attrLineRepeat;
+  if(line >= attrFirstLine && row < height) renderRow(f, screen, row, parity);
+}
+
+const uint16_t *AttrGraphics::buildLines(int line) {
+  uint32_t start = ESP.getCycleCount();
+  for(int screen = 0; screen < attrScreens; screen++) buildLine(frames[screen], screen, line);
+  uint32_t cycles = ESP.getCycleCount() - start;
+  if(cycles > lineCyclesMax) lineCyclesMax = cycles;
+  return lineBuffer;
+}
+
+void AttrGraphics::scanoutTask(void *self) {
+  AttrGraphics &g = *(AttrGraphics *)self;
+  for(;; g.field++){
+    for(int line = 0; line < attrFieldLines; line++){
+#if PSRAM_FRAME
+      // Rows after the one starting here; at line 0 the whole ring
+      // fills for the top of the field during vertical sync.
+      int row = (line - attrFirstLine) / attrLineRepeat;
+      if(line == 0 || (line >= attrFirstLine && row < g.height && (line - attrFirstLine) % attrLineRepeat == 0)){
+        g.nextSeq = g.field * g.height + (line == 0 ? 0 : row + 1);
+        xTaskNotifyGive(g.prefetchHandle);
+      }
+#endif
+      size_t written;
+      i2s_write(I2S_NUM_0, g.buildLines(line), g.lineBytes(), &written, portMAX_DELAY);
+    }
+  }
+}
+
+#if PSRAM_FRAME
+// Fills the ring from nextSeq on. The slot of the row being scanned
+// stays out of reach (depth - 1 rows ahead), and a slot's tag is
+// cleared while it is rewritten.
+void AttrGraphics::prefetchTask(void *self) {
+  AttrGraphics &g = *(AttrGraphics *)self;
+  for(;;){
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uint32_t from = g.nextSeq;
+    for(uint32_t seq = from; seq < from + attrPrefetchRows - 1; seq++){
+      int row = seq % g.height;
+      if(seq != from && row == 0) break;  // next field starts over at line 0
+      int slot = seq % attrPrefetchRows;
+      for(AttrFrame &f : g.frames){
+        if(f.ringSeq[slot] == seq) continue;
+        f.ringSeq[slot] = UINT32_MAX;
+        uint8_t *dst = f.ring + slot * g.cols * 2;
+        memcpy(dst, f.bitmap + row * g.cols, g.cols);
+        memcpy(dst + g.cols, f.attrs + (row >> 3) * g.cols, g.cols);
+        f.ringSeq[slot] = seq;
+      }
+    }
+  }
+}
+#endif
+#endif
 
 // --- Video setup ---
-CompositeGraphics graphics(CompositeVideo::PAL, 128, 96);
+const int screenWidth  = 128;
+const int screenHeight = 96;
+// Both scanouts are PAL; the layout solver also knows NTSC's overscan.
+enum VideoStandard { VIDEO_PAL, VIDEO_NTSC };
+const VideoStandard videoStandard = VIDEO_PAL;
+#if ATTR_VIDEO
+AttrGraphics graphics(screenWidth, screenHeight);
+#else
+CompositeGraphics graphics(CompositeVideo::PAL, screenWidth, screenHeight);
+#endif
 
 // --- Pins ---
 const int oilPin         = 2;
@@ -71,20 +642,86 @@ const int coolantPin     = 32;
 const int fuelPin        = 33;
 const int glowButtonPin  = 15;  // Button to start glow
 const int glowPin        = 16;  // MOSFET controlling glow plug
+const int ambientPin     = 34;  // Light sensor for night mode
+const int buzzerPin      = 4;   // Piezo for audible alarms
+const int telemetryTxPin = 13;  // UART2 TX for the telemetry stream
+const int glowSensePin   = -1;  // Glow current sense (analog), -1 if not fitted
+const int tftSclkPin     = 18;
+const int tftMosiPin     = 23;
+const int tftCsPin       = 5;
+const int tftDcPin       = 27;
+const int tftResetPin    = 14;
+const int ignitionPin    = -1;  // Ignition sense, falling edge = power about to go; -1 if not fitted
+
+// --- Scheduling ---
+// loop() never sleeps; each job runs when its period has elapsed.
+const unsigned long sensorPeriodUs    = 1000;   // acquisition, 1 kHz
+const unsigned long telemetryPeriodUs = 1000;   // telemetry snapshots, up to 1 kHz
+const unsigned long framePeriodUs     = 50000;  // render, 20 Hz
+const unsigned long memoryPeriodUs    = 1000000; // memory report, 1 Hz
+const int adcFilterShift              = 6;      // IIR weight 1/64 per sample (~64 ms)
+
+// --- Mirror ---
+const bool mirrorEnabled             = true;
+const unsigned long mirrorSliceUs    = 3000;  // max time per frame spent mirroring
+const unsigned long mirrorKeyframeMs = 5000;  // full resend so late viewers catch up
+const int mirrorTileWidth            = 16;
+const int mirrorTileHeight           = 8;
+
+// --- SPI TFT ---
+enum TftController { TFT_ILI9341, TFT_ST7789 };
+#ifndef TFT_ENABLED
+#define TFT_ENABLED false  // the host tests build with it on
+#endif
+const bool tftEnabled              = TFT_ENABLED;
+const TftController tftController  = TFT_ILI9341;
+const int tftWidth                 = 320;    // panel in landscape
+const int tftHeight                = 240;
+const int tftScale                 = 2;      // each dashboard pixel becomes scale x scale
+const int tftClockHz               = 40000000;
+const unsigned long tftSliceUs     = 3000;   // max CPU time per frame preparing spans
+
+// --- Watchdog ---
+const unsigned long watchdogPeriodMs = 50;  // heartbeat check interval
+const unsigned long flashOpMaxMs     = 1000; // longest flash erase/write waited out
+const unsigned long consoleCommandMaxMs = 2000; // longest console command waited out
+
+// --- Trip ---
+const int tripRefuelLiters = 5;  // rise over the trip's lowest level that counts as refuelling
+
+// --- Checkpoints ---
+const unsigned long checkpointMinIntervalMs = 30000; // between change-triggered writes
+const int checkpointFuelDelta               = 2;     // liters
+const unsigned long checkpointMaxAgeS       = 600;   // engine seconds between writes
+const int checkpointWriteAttempts           = 2;     // per request; the slot is erased between them
+const unsigned long ignitionHoldoffMs       = 2000;  // edges this soon after a handled one are ignored
 
 // --- Calibration ---
-const int coolantADCMin  = 100;
-const int coolantADCMax  = 900;
-const int coolantCMin    = 0;
-const int coolantCMax    = 120;
-const int coolantCriticalC = 100;
-const int coolantNormalMin = 70; // normal operating temp
-
-const int fuelADCMin     = 80;
-const int fuelADCMax     = 900;
-const int fuelLitersMin  = 0;
-const int fuelLitersMax  = 50;
-const int fuelCriticalLiters = 5;
+// Not const: the serial console can change these live ("cal").
+int coolantADCMin  = 100;
+int coolantADCMax  = 900;
+int coolantCMin    = 0;
+int coolantCMax    = 120;
+int coolantCriticalC = 100;
+int coolantNormalMin = 70; // normal operating temp
+
+int fuelADCMin     = 80;
+int fuelADCMax     = 900;
+int fuelLitersMin  = 0;
+int fuelLitersMax  = 50;
+int fuelCriticalLiters = 5;
+
+// --- Self-test ---
+const unsigned long selfTestShowMs = 5000; // pass/fail row shown this long after boot
+const int selfTestSlackPct         = 50;   // allowed slowdown over baseline
+const unsigned long selfTestSlackUs = 20;  // absolute slack for tiny timings
+const unsigned long glowPulseUs    = 2000; // self-test glow pulse
+const int glowSenseMinADC          = 200;  // below this during the pulse = open load
+
+// --- Console ---
+const int consoleLineMax    = 48;  // longer lines are discarded
+const int consoleMaxArgs    = 4;
+const int consoleBytesPerPass = 32; // bytes taken from the UART per loop()
 
 // --- Glow parameters ---
 const int glowMinTime    = 3;  // seconds
@@ -98,10 +735,51 @@ bool flashState          = true;
 const unsigned long flashInterval = 500;
 
 // --- Colors ---
+// Set from the active UiPalette; see "Night mode".
 uint16_t DARKBLUE = 10; // normal background
 uint16_t WHITE     = 40; // flash
 uint16_t BLACK     = 0;
 
+struct UiPalette {
+  uint16_t background;
+  uint16_t white;
+  uint16_t black;
+};
+
+const UiPalette dayPalette   = { 10, 40, 0 };
+const UiPalette nightPalette = { 2,  20, 0 };
+
+// --- Night mode ---
+const int ambientNightADC = 300;            // darker than this → night
+const int ambientDayADC   = 600;            // brighter than this → day
+const unsigned long nightSwitchMs = 3000;   // must stay past the threshold this long
+
+// --- Animation ---
+const int barEaseShift   = 2;  // each frame moves 1/4 of the remaining distance
+const int barMaxWidth    = 40; // filled columns at full scale
+#if ATTR_VIDEO
+const int fixedCharAdvance = attrCharAdvance;  // print()'s font
+#else
+const int fixedCharAdvance = 8;
+#endif
+const int notDrawn       = -1; // widget state meaning "not on screen"
+
+// --- Pages ---
+const unsigned long longPressMs = 800;  // button hold that switches page
+const size_t pageCacheBudget    = 8192; // max bytes of static layer cached per page
+
+// --- Memory ---
+const size_t arenaBytes = 44 * 1024;    // page caches, mirror and TFT shadows
+
+// --- Frame timing ---
+const unsigned long frameBudgetUs = 20000; // a longer runFrame() is an overrun and traced
+const int histBuckets             = 16;    // log2 buckets, the last one open-ended
+const int overrunTraceCount       = 4;     // most recent overruns kept
+
+// --- Markers ---
+const unsigned long markerHoldMs  = 10000; // extreme is held this long
+const unsigned long markerDecayMs = 500;   // then creeps back one unit per step
+
 // -------------------------------------------------------------------
 // Pixel-art icons (16x16)
 const unsigned char oilIcon[32] PROGMEM = { /* same as before */ 
@@ -148,6 +826,17 @@ const unsigned char glowIcon[32] PROGMEM = { /* same as before */
   0b00011111,0b11100000,0b00001111,0b10000000
 };
 
+#if ATTR_VIDEO
+// Bar marker sprite: one column, as tall as the bar's fill
+const unsigned char markerSprite[32] PROGMEM = {
+  0x80,0x00, 0x80,0x00, 0x80,0x00, 0x80,0x00, 0x80,0x00, 0x80,0x00, 0x80,0x00, 0x80,0x00,
+};
+
+// Sprite slots: one marker per channel, then the glow icon
+const int spriteMarker = 0;
+const int spriteGlow   = 3;
+#endif
+
 // -------------------------------------------------------------------
 // Conversion functions
 int adcToCoolantC(int adc) {
@@ -160,6 +849,142 @@ int adcToFuelLiters(int adc) {
                    fuelLitersMin, fuelLitersMax);
 }
 
+// -------------------------------------------------------------------
+// Subsystem health
+// Every subsystem beats its heartbeat each time it runs, and the code
+// sets activeProbe on entry to each piece of work. The watchdog task
+// (see "Watchdog") uses both to tell which subsystem stalled and where.
+enum Subsystem : uint8_t { SUB_ACQUISITION, SUB_GLOW, SUB_RENDER, SUB_LOGGER, SUB_COUNT };
+
+enum Probe : uint8_t {
+  PROBE_IDLE, PROBE_SENSORS, PROBE_TELEMETRY, PROBE_CONSOLE, PROBE_UPDATE,
+  PROBE_GLOW, PROBE_DRAW, PROBE_MIRROR, PROBE_TFT, PROBE_COUNT
+};
+
+const char *const subsystemNames[SUB_COUNT] = { "ACQ", "GLOW", "RENDER", "LOGGER" };
+const char *const probeNames[PROBE_COUNT] = {
+  "IDLE", "SENSORS", "TELEM", "CONSOLE", "UPDATE", "GLOW", "DRAW", "MIRROR", "TFT"
+};
+const unsigned long heartbeatTimeoutMs[SUB_COUNT] = { 100, 500, 500, 500 };
+
+volatile unsigned long heartbeatMs[SUB_COUNT];
+volatile uint8_t activeProbe = PROBE_IDLE;
+volatile int injectedStall = -1;   // subsystem the console asked to hang
+
+// Survives the watchdog's software reset (not a power cycle).
+struct StallRecord {
+  uint32_t magic;
+  uint8_t subsystem;
+  uint8_t probe;
+  uint32_t uptimeMs;
+  uint32_t stalledMs;
+};
+const uint32_t stallMagic = 0x5354414C;  // "STAL"
+RTC_NOINIT_ATTR StallRecord stallRecord;
+StallRecord lastStall;  // copy from the previous run, magic == 0 if none
+
+inline void beat(Subsystem sub) {
+  heartbeatMs[sub] = millis();
+}
+
+inline void probe(Probe p) {
+  activeProbe = p;
+}
+
+// -------------------------------------------------------------------
+// Sensor acquisition
+// ADC readings are sampled at sensorPeriodUs and smoothed with an IIR of
+// weight 1/2^adcFilterShift so gauge targets stay put between frames
+// instead of chasing ADC noise. The filter state keeps adcFilterShift
+// fractional bits: shifting the step itself would drop any difference
+// under 2^adcFilterShift and leave a rising reading stuck below the
+// input, while a falling one (arithmetic shift rounds down) converged.
+struct AdcFilter {
+  int32_t state;  // filtered value << adcFilterShift
+};
+struct SensorData {
+  bool oilCritical;
+  int  coolantRaw;
+  int  fuelRaw;
+  int  coolantADC;   // filtered
+  int  fuelADC;      // filtered
+  int  ambientADC;   // filtered
+  int  coolantC;
+  int  fuelLiters;
+  bool coolantCritical;
+  bool fuelCritical;
+};
+
+SensorData sensors;
+AdcFilter coolantFilter, fuelFilter, ambientFilter;
+
+// Alarm overrides set from the console ("force")
+enum ForceState : uint8_t { FORCE_AUTO, FORCE_ON, FORCE_OFF };
+ForceState forceOil = FORCE_AUTO, forceCoolant = FORCE_AUTO, forceFuel = FORCE_AUTO;
+
+bool applyForce(ForceState force, bool measured) {
+  return force == FORCE_AUTO ? measured : (force == FORCE_ON);
+}
+
+void seedFilter(AdcFilter &filter, int raw) {
+  filter.state = (int32_t)raw << adcFilterShift;
+}
+
+// Returns the filtered value rounded to the nearest count.
+int filterADC(AdcFilter &filter, int raw) {
+  filter.state += raw - ((filter.state + (1 << (adcFilterShift - 1))) >> adcFilterShift);
+  return (filter.state + (1 << (adcFilterShift - 1))) >> adcFilterShift;
+}
+
+void readSensors() {
+  sensors.oilCritical     = applyForce(forceOil, digitalRead(oilPin) == HIGH);
+  sensors.coolantRaw      = analogRead(coolantPin);
+  sensors.fuelRaw         = analogRead(fuelPin);
+  sensors.coolantADC      = filterADC(coolantFilter, sensors.coolantRaw);
+  sensors.fuelADC         = filterADC(fuelFilter, sensors.fuelRaw);
+  sensors.ambientADC      = filterADC(ambientFilter, analogRead(ambientPin));
+  sensors.coolantC        = adcToCoolantC(sensors.coolantADC);
+  sensors.fuelLiters      = adcToFuelLiters(sensors.fuelADC);
+  sensors.coolantCritical = applyForce(forceCoolant, sensors.coolantC > coolantCriticalC);
+  sensors.fuelCritical    = applyForce(forceFuel, sensors.fuelLiters <= fuelCriticalLiters);
+}
+
+bool anyCritical() {
+  return sensors.oilCritical || sensors.coolantCritical || sensors.fuelCritical;
+}
+
+// -------------------------------------------------------------------
+// Trip statistics, updated incrementally from every reading
+// A trip runs until the tank is refilled (the level rises
+// tripRefuelLiters over the trip's lowest) or "trip reset" is typed on
+// the console. Checkpoints carry it across power cycles in between.
+struct TripStats {
+  unsigned long startMs;
+  int startFuelLiters;
+  int maxCoolantC;
+  int minFuelLiters;
+};
+
+TripStats trip;
+
+void resetTrip() {
+  trip.startMs         = millis();
+  trip.startFuelLiters = sensors.fuelLiters;
+  trip.maxCoolantC     = sensors.coolantC;
+  trip.minFuelLiters   = sensors.fuelLiters;
+}
+
+// Returns true when refuelling ended the trip and a new one started.
+bool updateTrip() {
+  if(sensors.fuelLiters >= trip.minFuelLiters + tripRefuelLiters){
+    resetTrip();
+    return true;
+  }
+  if(sensors.coolantC > trip.maxCoolantC) trip.maxCoolantC = sensors.coolantC;
+  if(sensors.fuelLiters < trip.minFuelLiters) trip.minFuelLiters = sensors.fuelLiters;
+  return false;
+}
+
 // -------------------------------------------------------------------
 // Flash utility
 bool shouldFlash() {
@@ -172,130 +997,2785 @@ bool shouldFlash() {
 }
 
 // -------------------------------------------------------------------
-// Drawing functions
-void drawBackground(bool warningMode, bool flash) {
-  graphics.fillScreen((warningMode && flash) ? WHITE : DARKBLUE);
+// Channels
+// Everything a widget can show is addressed by channel, so a layout only
+// has to name the channel instead of the sensor.
+enum Channel : uint8_t { CH_OIL, CH_COOLANT, CH_FUEL, CH_COUNT };
+
+const char *const channelUnits[CH_COUNT] = { "", "C", "L" };
+
+int channelValue(uint8_t ch) {
+  switch(ch){
+    case CH_OIL:     return sensors.oilCritical ? 1 : 0;
+    case CH_COOLANT: return sensors.coolantC;
+    default:         return sensors.fuelLiters;
+  }
 }
 
-// -------------------------------------------------------------------
-// Metric-specific functions
-void handleOilStatus(bool flash) {
-  bool oilCritical = (digitalRead(oilPin) == HIGH);
-  uint16_t iconColor = oilCritical ? 1 : 5;
-  uint16_t textColor = (oilCritical && flash) ? BLACK : WHITE;
+bool channelCritical(uint8_t ch) {
+  switch(ch){
+    case CH_OIL:     return sensors.oilCritical;
+    case CH_COOLANT: return sensors.coolantCritical;
+    default:         return sensors.fuelCritical;
+  }
+}
 
-  graphics.drawBitmap(0,10,oilIcon,16,16,iconColor);
-  if(oilCritical){
-    graphics.setCursor(20,12);
-    graphics.setHue(textColor);
-    graphics.print("LOW PRESSURE");
+uint16_t channelHueRaw(uint8_t ch) {
+  switch(ch){
+    case CH_OIL:
+      return sensors.oilCritical ? 1 : 5;
+    case CH_COOLANT: {
+      int coolantC = sensors.coolantC;
+      if(coolantC < coolantNormalMin) return 30; // orange
+      if(coolantC <= coolantCriticalC) return map(coolantC, coolantNormalMin, coolantCriticalC, 120, 0); // green→red
+      return 0; // red
+    }
+    default:
+      return sensors.fuelCritical ? 0 : map(sensors.fuelLiters, fuelCriticalLiters, fuelLitersMax, 30, 120);
   }
 }
 
-void handleCoolantTemp(bool flash) {
-  int coolantADC = analogRead(coolantPin);
-  int coolantC = adcToCoolantC(coolantADC);
-  bool coolantCritical = (coolantC > coolantCriticalC);
+// Gauge hues share the color values of the UI colors. A hue that lands
+// on a background or white of either palette moves one step over, so
+// night-mode remapping (which rewrites those values on screen) leaves
+// icons and bars alone. Black is the same in both palettes and so is
+// never remapped.
+uint16_t avoidUiColors(int hue) {
+  bool ui = hue == dayPalette.background || hue == dayPalette.white ||
+            hue == nightPalette.background || hue == nightPalette.white;
+  return ui ? hue + 1 : hue;
+}
+
+uint16_t channelHue(uint8_t ch) {
+  return avoidUiColors(channelHueRaw(ch));
+}
+
+// -------------------------------------------------------------------
+// Gauge animation
+// Bar values ease toward their target in Q8 fixed point; once a bar
+// reaches its target it stops animating and costs nothing until the
+// target moves again.
+struct BarGauge {
+  int valueMin, valueMax;
+  int32_t shownQ8;     // displayed value, Q8
+  int target;
+  bool animating;
+};
+
+// Holds the highest (or lowest) recent reading of a channel. After
+// markerHoldMs without a new extreme it decays back toward the live value.
+struct GaugeMarker {
+  bool holdMax;
+  int value;
+  unsigned long heldAt;
+};
 
-  uint16_t textColor = (coolantCritical && flash) ? BLACK : WHITE;
-  uint16_t hue;
+BarGauge gauges[CH_COUNT] = {
+  { 0, 1, 0, 0, false },
+  { coolantCMin, coolantCMax, 0, 0, false },
+  { fuelLitersMin, fuelLitersMax, 0, 0, false },
+};
+GaugeMarker markers[CH_COUNT] = {
+  { true,  0, 0 },
+  { true,  0, 0 },  // coolant: trip peak
+  { false, 0, 0 },  // fuel: low point
+};
 
-  if(coolantC < coolantNormalMin) hue = 30; // orange
-  else if(coolantC <= coolantCriticalC) hue = map(coolantC, coolantNormalMin, coolantCriticalC, 120, 0); // green→red
-  else hue = 0; // red
+void setBarTarget(BarGauge &bar, int value) {
+  if(value != bar.target){
+    bar.target = value;
+    bar.animating = true;
+  }
+}
 
-  graphics.drawBitmap(0,30,tempIcon,16,16,hue);
-  int barWidth = map(coolantC, coolantCMin, coolantCMax, 0,40);
-  graphics.drawRect(20,30,42,10,0);
-  graphics.fillRect(21,31,barWidth,8,hue);
+// Advance the easing by one frame.
+void tickBar(BarGauge &bar) {
+  if(!bar.animating) return;
+  int32_t targetQ8 = (int32_t)bar.target << 8;
+  int32_t delta = targetQ8 - bar.shownQ8;
+  if(delta > -64 && delta < 64){ // within a quarter unit: snap and stop
+    bar.shownQ8 = targetQ8;
+    bar.animating = false;
+  } else {
+    bar.shownQ8 += delta >> barEaseShift;
+  }
+}
 
-  graphics.setCursor(70,30);
-  graphics.setHue(textColor);
-  graphics.print(String(coolantC)+"C");
+int barShownValue(const BarGauge &bar) {
+  return (bar.shownQ8 + 128) >> 8;
 }
 
-void handleFuelLevel(bool flash) {
-  int fuelADC = analogRead(fuelPin);
-  int fuelLiters = adcToFuelLiters(fuelADC);
-  bool fuelCritical = (fuelLiters <= fuelCriticalLiters);
-  uint16_t textColor = (fuelCritical && flash) ? BLACK : WHITE;
-  uint16_t hue = fuelCritical ? 0 : map(fuelLiters, fuelCriticalLiters, fuelLitersMax, 30, 120);
+void updateMarker(GaugeMarker &marker, int reading) {
+  unsigned long now = millis();
+  bool extreme = marker.holdMax ? (reading >= marker.value) : (reading <= marker.value);
+  if(extreme){
+    marker.value = reading;
+    marker.heldAt = now;
+  } else if(now - marker.heldAt > markerHoldMs){
+    marker.value += marker.holdMax ? -1 : 1;
+    marker.heldAt = now - markerHoldMs + markerDecayMs;
+  }
+}
 
-  graphics.drawBitmap(0,50,fuelIcon,16,16,hue);
-  int barWidth = map(fuelLiters, fuelLitersMin, fuelLitersMax, 0,40);
-  graphics.drawRect(20,50,42,10,0);
-  graphics.fillRect(21,51,barWidth,8,hue);
+void resetMarkers() {
+  for(uint8_t ch = 0; ch < CH_COUNT; ch++) markers[ch].value = channelValue(ch);
+}
 
-  graphics.setCursor(70,50);
-  graphics.setHue(textColor);
-  graphics.print(String(fuelLiters)+"L");
+void updateGauges() {
+  for(uint8_t ch = 0; ch < CH_COUNT; ch++){
+    int value = channelValue(ch);
+    setBarTarget(gauges[ch], value);
+    tickBar(gauges[ch]);
+    updateMarker(markers[ch], value);
+  }
 }
 
 // -------------------------------------------------------------------
-// Glow plug handling
-void drawGlowScreen(int remainingSeconds) {
-  graphics.fillScreen(WHITE);
-  graphics.setHue(BLACK);
-  graphics.setCursor(50,40);
-  graphics.print(remainingSeconds);
-  graphics.drawBitmap(110,0,glowIcon,16,16,1);
+// Layout
+// Screens are described by a compact binary blob, so each vehicle can
+// get its own screen by flashing a "layout" data partition instead of
+// recompiling. Format (all bytes):
+//   'L' 'Y' version count
+//   count x { type, x, y, channel, style }
+// At load the blob is validated and expanded into a flat Widget array
+// which also carries each widget's retained screen state.
+enum WidgetType : uint8_t { W_ICON, W_BAR, W_VALUE, W_ALARM_TEXT, W_BIG_VALUE, W_TYPE_COUNT };
+
+const uint8_t ICON_OIL = 0, ICON_TEMP = 1, ICON_FUEL = 2, ICON_GLOW = 3;
+const uint8_t BAR_MARKER = 0x01;  // bar style: draw the channel's hold marker
+const int bigDigitsMax     = 4;   // big value style: digit count, 1..bigDigitsMax
+const int bigDigitAdvance  = 11;  // 9-pixel digit plus gap
+const int bigUnitWidth     = 8;   // area cleared before the unit is reprinted
+constexpr int bigValueWidth(int digits) { return digits * bigDigitAdvance + bigUnitWidth; }
+
+const unsigned char *const icons[] = { oilIcon, tempIcon, fuelIcon, glowIcon };
+const int iconCount = sizeof(icons) / sizeof(icons[0]);
+const char *const alarmTexts[] = { "LOW PRESSURE" };
+const int alarmTextCount = sizeof(alarmTexts) / sizeof(alarmTexts[0]);
+
+const uint8_t layoutVersion    = 1;
+const int layoutHeaderSize     = 4;
+const int layoutRecordSize     = 5;
+const int maxWidgets           = 24;
+
+// The default layout is solved at compile time: rows of gaugeRowHeight
+// every gaugeRowPitch from the top of the safe area, and columns spread
+// across its width with equal gaps, each widget aligned in its cell.
+// The safe area is the screen minus the overscan a set of the video
+// standard typically crops, so another resolution or standard moves
+// everything with it. The coordinates fold to constants in the blob.
+enum Align { ALIGN_START, ALIGN_CENTER, ALIGN_END };
+
+const int gaugeRowPitch  = 20;
+const int gaugeRowHeight = 16;
+const int gaugeColumnCount = 3;
+constexpr int gaugeColumns[gaugeColumnCount] = {  // icon, bar, big value with unit
+  16, barMaxWidth + 2, bigValueWidth(3),
+};
+
+constexpr int overscanPercent(VideoStandard standard) { return standard == VIDEO_NTSC ? 7 : 5; }
+constexpr int safeMargin(int size) { return size * overscanPercent(videoStandard) / 100; }
+constexpr int safeSize(int size) { return size - 2 * safeMargin(size); }
+constexpr int widthBefore(const int *widths, int column) {
+  return column == 0 ? 0 : widths[column - 1] + widthBefore(widths, column - 1);
+}
+constexpr int columnGap(const int *widths, int count) {
+  return (safeSize(screenWidth) - widthBefore(widths, count)) / (count - 1);
+}
+constexpr int columnX(const int *widths, int count, int column) {
+  return safeMargin(screenWidth) + widthBefore(widths, column) + column * columnGap(widths, count);
+}
+constexpr int alignIn(int start, int cell, int size, Align align) {
+  return align == ALIGN_START ? start : align == ALIGN_END ? start + cell - size : start + (cell - size) / 2;
+}
+constexpr uint8_t gaugeX(int column, int width, Align align) {
+  return alignIn(columnX(gaugeColumns, gaugeColumnCount, column), gaugeColumns[column], width, align);
 }
+constexpr uint8_t gaugeY(int row, int height, Align align) {
+  return alignIn(safeMargin(screenHeight) + row * gaugeRowPitch, gaugeRowHeight, height, align);
+}
+static_assert(columnGap(gaugeColumns, gaugeColumnCount) >= 0, "gauge columns do not fit the safe area");
+static_assert(gaugeY(2, gaugeRowHeight, ALIGN_START) + gaugeRowHeight <= screenHeight - safeMargin(screenHeight),
+              "gauge rows do not fit the safe area");
 
-void handleGlowPlug() {
-  static bool glowActive = false;
-  static unsigned long glowStartTime = 0;
-  static int glowDuration = 0;
+const uint8_t defaultLayout[] PROGMEM = {
+  'L', 'Y', layoutVersion, 8,
+  W_ICON,       gaugeX(0, 16, ALIGN_START), gaugeY(0, 16, ALIGN_START), CH_OIL, ICON_OIL,
+  W_ALARM_TEXT, gaugeX(1, 0, ALIGN_START),  gaugeY(0, 8, ALIGN_CENTER), CH_OIL, 0,
+  W_ICON,       gaugeX(0, 16, ALIGN_START), gaugeY(1, 16, ALIGN_START), CH_COOLANT, ICON_TEMP,
+  W_BAR,        gaugeX(1, barMaxWidth + 2, ALIGN_START), gaugeY(1, 10, ALIGN_CENTER), CH_COOLANT, BAR_MARKER,
+  W_BIG_VALUE,  gaugeX(2, bigValueWidth(3), ALIGN_END), gaugeY(1, 16, ALIGN_START), CH_COOLANT, 3,
+  W_ICON,       gaugeX(0, 16, ALIGN_START), gaugeY(2, 16, ALIGN_START), CH_FUEL, ICON_FUEL,
+  W_BAR,        gaugeX(1, barMaxWidth + 2, ALIGN_START), gaugeY(2, 10, ALIGN_CENTER), CH_FUEL, BAR_MARKER,
+  W_BIG_VALUE,  gaugeX(2, bigValueWidth(2), ALIGN_END), gaugeY(2, 16, ALIGN_START), CH_FUEL, 2,
+};
 
-  // Read coolant for glow duration
-  int coolantADC = analogRead(coolantPin);
-  int coolantC = adcToCoolantC(coolantADC);
+struct Widget {
+  uint8_t type, channel, style;
+  uint8_t x, y;
+  // Retained state: what the widget last put on screen
+  int drawnHue;     // icon, bar
+  int drawnWidth;   // bar fill columns
+  int drawnMarker;  // bar marker column
+  int drawnValue;   // value, big value
+  int drawnColor;   // value, big value, alarm text
+};
 
-  if(!glowActive && digitalRead(glowButtonPin) == LOW){
-    glowActive = true;
-    glowDuration = map(coolantC, glowTempMin, glowTempMax, glowMaxTime, glowMinTime);
-    glowDuration = constrain(glowDuration, glowMinTime, glowMaxTime);
-    glowStartTime = millis();
-    digitalWrite(glowPin, HIGH);
+Widget widgets[maxWidgets];
+int widgetCount = 0;
+unsigned long layoutLoadUs = 0;
+
+// Attribute video colors whole 8x8 cells, so widgets start on a cell
+// boundary there and do not share cells with their neighbours.
+uint8_t snapToCell(uint8_t v) {
+  return ATTR_VIDEO ? v & ~7 : v;
+}
+
+bool parseLayout(const uint8_t *blob, size_t size) {
+  if(size < layoutHeaderSize || blob[0] != 'L' || blob[1] != 'Y' || blob[2] != layoutVersion) return false;
+  int count = blob[3];
+  if(count > maxWidgets || size < (size_t)(layoutHeaderSize + count * layoutRecordSize)) return false;
+
+  for(int i = 0; i < count; i++){
+    const uint8_t *rec = blob + layoutHeaderSize + i * layoutRecordSize;
+    Widget &w = widgets[i];
+    w.type = rec[0]; w.x = snapToCell(rec[1]); w.y = snapToCell(rec[2]); w.channel = rec[3]; w.style = rec[4];
+    if(w.type >= W_TYPE_COUNT || w.channel >= CH_COUNT) return false;
+    if(w.x >= screenWidth || w.y >= screenHeight) return false;
+    if(w.type == W_ICON && w.style >= iconCount) return false;
+    if(w.type == W_ALARM_TEXT && w.style >= alarmTextCount) return false;
+    if(w.type == W_BIG_VALUE && (w.style < 1 || w.style > bigDigitsMax)) return false;
   }
+  widgetCount = count;
+  return true;
+}
 
-  if(glowActive){
-    int elapsed = (millis() - glowStartTime)/1000;
-    int remaining = glowDuration - elapsed;
-    if(remaining <= 0){
-      glowActive = false;
-      digitalWrite(glowPin, LOW);
-    } else {
-      drawGlowScreen(remaining);
-      delay(50);
-    }
+// Falls back to the built-in layout when there is no valid partition.
+void loadLayout() {
+  unsigned long start = micros();
+  static uint8_t blob[layoutHeaderSize + maxWidgets * layoutRecordSize];
+  const char *source = "partition";
+
+  const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                         ESP_PARTITION_SUBTYPE_ANY, "layout");
+  size_t size = part ? min((size_t)part->size, sizeof(blob)) : 0;
+  if(!part || esp_partition_read(part, 0, blob, size) != ESP_OK || !parseLayout(blob, size)){
+    memcpy_P(blob, defaultLayout, sizeof(defaultLayout));
+    parseLayout(blob, sizeof(defaultLayout));
+    source = "default";
   }
+  layoutLoadUs = micros() - start;
+  Serial.printf("layout: %d widgets from %s in %lu us\n", widgetCount, source, layoutLoadUs);
 }
 
 // -------------------------------------------------------------------
-// Setup & loop
-void setup() {
-  pinMode(oilPin, INPUT_PULLUP);
-  pinMode(coolantPin, INPUT);
-  pinMode(fuelPin, INPUT);
-  pinMode(glowButtonPin, INPUT_PULLUP);
-  pinMode(glowPin, OUTPUT);
-  digitalWrite(glowPin, LOW);
+// Frame timing
+// Every runFrame() goes into a log2 histogram: bucket n counts frames
+// of 2^n up to 2^(n+1) us, the last bucket everything longer. A frame
+// over frameBudgetUs also leaves a trace: the time of each phase, how
+// late the frame started, the slowest sensor pass before it, how many
+// value labels were rebuilt (each builds a String) and whether a
+// checkpoint was writing flash (flash operations stall both cores).
+enum FramePhase { PHASE_UPDATE, PHASE_GLOW, PHASE_DRAW, PHASE_MIRROR, PHASE_TFT, PHASE_COUNT };
+const char *const phaseNames[PHASE_COUNT] = { "update", "glow", "draw", "mirror", "tft" };
 
-  graphics.begin();
-  graphics.setFont(0);
+struct FrameTrace {
+  unsigned long atMs;
+  uint16_t totalUs;      // 0 = slot unused
+  uint16_t phaseUs[PHASE_COUNT];
+  uint16_t lateUs;       // start past its scheduled time
+  uint16_t sensorMaxUs;  // slowest readSensors() since the previous frame
+  uint8_t  textBuilds;
+  bool     flashBusy;    // a flash erase/write overlapped the frame
+};
+
+uint32_t frameHist[histBuckets];
+unsigned long frameOverruns = 0;
+FrameTrace overrunTraces[overrunTraceCount];
+int overrunNext = 0;  // ring slot for the next trace
+
+// Collected while a frame runs
+uint16_t framePhaseUs[PHASE_COUNT];
+uint8_t  frameTextBuilds = 0;
+uint16_t sensorMaxUs = 0;
+uint32_t frameFlashOps = 0;  // flashOps when the frame started
+volatile bool flashWriteActive = false;  // set by the checkpoint task
+volatile uint32_t flashOps = 0;          // flash operations started
+volatile unsigned long flashOpStartMs = 0;
+
+uint16_t saturate16(unsigned long value) {
+  return value > 0xFFFF ? 0xFFFF : value;
 }
 
-void loop() {
-  bool flash = shouldFlash();
+int histBucket(unsigned long us) {
+  int bucket = 31 - __builtin_clz(us | 1);
+  return bucket < histBuckets ? bucket : histBuckets - 1;
+}
 
-  handleGlowPlug();
+// Phases are timed back to back: each one ends where the next starts.
+void endPhase(FramePhase phase, unsigned long &mark) {
+  unsigned long now = micros();
+  framePhaseUs[phase] = saturate16(now - mark);
+  mark = now;
+}
 
-  if(digitalRead(glowPin) == LOW){ // normal gauges
-    drawBackground(flash);
-    handleOilStatus(flash);
-    handleCoolantTemp(flash);
-    handleFuelLevel(flash);
+void recordFrame(unsigned long totalUs, unsigned long lateUs) {
+  frameHist[histBucket(totalUs)]++;
+  if(totalUs > frameBudgetUs){
+    frameOverruns++;
+    FrameTrace &trace = overrunTraces[overrunNext];
+    overrunNext = (overrunNext + 1) % overrunTraceCount;
+    trace.atMs        = millis();
+    trace.totalUs     = saturate16(totalUs);
+    memcpy(trace.phaseUs, framePhaseUs, sizeof(trace.phaseUs));
+    trace.lateUs      = saturate16(lateUs);
+    trace.sensorMaxUs = sensorMaxUs;
+    trace.textBuilds  = frameTextBuilds;
+    trace.flashBusy   = flashOps != frameFlashOps || flashWriteActive;
   }
+  frameTextBuilds = 0;
+  sensorMaxUs = 0;
+}
+
+void resetFrameHistogram() {
+  memset(frameHist, 0, sizeof(frameHist));
+  memset(overrunTraces, 0, sizeof(overrunTraces));
+  frameOverruns = 0;
+  overrunNext = 0;
+}
+
+// -------------------------------------------------------------------
+// Proportional text
+// Labels and alarm texts use a proportional 5x7 face: each glyph keeps
+// only its inked columns and advances by their count plus one, with a
+// few kerning pairs, all as tables in flash. "LOW PRESSURE" is 68
+// pixels wide in it. Values keep the fixed font, so digits do not shift.
+//
+// A string is rendered into a run: a 1bpp bitmap in drawBitmap()'s
+// layout, so drawing it is a single blit. drawStaticText() keeps the
+// runs of strings with static storage in textRunPool, found by pointer,
+// and builds each only on first use; drawText() renders into a stack
+// buffer every time. Strings that do not fit the pool any more are
+// drawn uncached. "font" on the console times both against print().
+// Inked columns of ' ' to 'Z', top pixel in bit 0 (',' reaches row 7)
+const uint8_t propGlyphs[] PROGMEM = {
+  0x5F, 0x07, 0x00, 0x07, 0x14, 0x7F, 0x14, 0x7F, 0x14, 0x24, 0x2A, 0x7F, 0x2A, 0x12, 0x23, 0x13,
+  0x08, 0x64, 0x62, 0x36, 0x49, 0x56, 0x20, 0x50, 0x08, 0x07, 0x03, 0x1C, 0x22, 0x41, 0x41, 0x22,
+  0x1C, 0x2A, 0x1C, 0x7F, 0x1C, 0x2A, 0x08, 0x08, 0x3E, 0x08, 0x08, 0x80, 0x70, 0x30, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x60, 0x60, 0x20, 0x10, 0x08, 0x04, 0x02, 0x3E, 0x51, 0x49, 0x45, 0x3E, 0x42,
+  0x7F, 0x40, 0x72, 0x49, 0x49, 0x49, 0x46, 0x21, 0x41, 0x49, 0x4D, 0x33, 0x18, 0x14, 0x12, 0x7F,
+  0x10, 0x27, 0x45, 0x45, 0x45, 0x39, 0x3C, 0x4A, 0x49, 0x49, 0x31, 0x41, 0x21, 0x11, 0x09, 0x07,
+  0x36, 0x49, 0x49, 0x49, 0x36, 0x46, 0x49, 0x49, 0x29, 0x1E, 0x14, 0x40, 0x34, 0x08, 0x14, 0x22,
+  0x41, 0x14, 0x14, 0x14, 0x14, 0x14, 0x41, 0x22, 0x14, 0x08, 0x02, 0x01, 0x59, 0x09, 0x06, 0x3E,
+  0x41, 0x5D, 0x59, 0x4E, 0x7C, 0x12, 0x11, 0x12, 0x7C, 0x7F, 0x49, 0x49, 0x49, 0x36, 0x3E, 0x41,
+  0x41, 0x41, 0x22, 0x7F, 0x41, 0x41, 0x41, 0x3E, 0x7F, 0x49, 0x49, 0x49, 0x41, 0x7F, 0x09, 0x09,
+  0x09, 0x01, 0x3E, 0x41, 0x41, 0x51, 0x73, 0x7F, 0x08, 0x08, 0x08, 0x7F, 0x41, 0x7F, 0x41, 0x20,
+  0x40, 0x41, 0x3F, 0x01, 0x7F, 0x08, 0x14, 0x22, 0x41, 0x7F, 0x40, 0x40, 0x40, 0x40, 0x7F, 0x02,
+  0x1C, 0x02, 0x7F, 0x7F, 0x04, 0x08, 0x10, 0x7F, 0x3E, 0x41, 0x41, 0x41, 0x3E, 0x7F, 0x09, 0x09,
+  0x09, 0x06, 0x3E, 0x41, 0x51, 0x21, 0x5E, 0x7F, 0x09, 0x19, 0x29, 0x46, 0x26, 0x49, 0x49, 0x49,
+  0x32, 0x03, 0x01, 0x7F, 0x01, 0x03, 0x3F, 0x40, 0x40, 0x40, 0x3F, 0x1F, 0x20, 0x40, 0x20, 0x1F,
+  0x3F, 0x40, 0x38, 0x40, 0x3F, 0x63, 0x14, 0x08, 0x14, 0x63, 0x03, 0x04, 0x78, 0x04, 0x03, 0x61,
+  0x59, 0x49, 0x4D, 0x43,
+};
+// First column of each glyph; the next entry ends it
+const uint16_t propGlyphOffset[] PROGMEM = {
+  0, 0, 1, 4, 9, 14, 19, 24, 27, 30, 33, 38, 43, 46, 51, 53,
+  58, 63, 66, 71, 76, 81, 86, 91, 96, 101, 106, 107, 109, 113, 118, 122,
+  127, 132, 137, 142, 147, 152, 157, 162, 167, 172, 175, 180, 185, 190, 195, 200,
+  205, 210, 215, 220, 225, 230, 235, 240, 245, 250, 255, 260,
+};
+// Columns plus a one-pixel gap; ' ' is three blank columns
+const uint8_t propGlyphAdvance[] PROGMEM = {
+  3, 2, 4, 6, 6, 6, 6, 4, 4, 4, 6, 6, 4, 6, 3, 6, 6, 4, 6, 6, 6, 6, 6, 6, 6, 6, 2, 3, 5, 6,
+  5, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 4, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+};
+// Pairs set one pixel closer: their facing columns share no row
+const char propKernPairs[] PROGMEM = "LTLVLYFATJFJP.T.F.Y.";
+
+const int propHeight       = 8;
+const int textRunMaxStride = screenWidth / 8;
+const int textRunSlots     = 32;
+const int textRunPoolBytes = 1024;
+
+struct TextRun {
+  const char *text;
+  uint16_t offset;  // into textRunPool
+  uint8_t stride;   // bytes per row
+};
+
+TextRun textRuns[textRunSlots];
+int textRunCount = 0;
+uint8_t textRunPool[textRunPoolBytes];
+size_t textRunPoolUsed = 0;
 
-  delay(50);
+int propGlyphIndex(char c) {
+  c = toupper(c);
+  return (c < ' ' || c > 'Z') ? '?' - ' ' : c - ' ';
+}
+
+int propKerning(char left, char right) {
+  for(const char *pair = propKernPairs; pgm_read_byte(pair); pair += 2){
+    if(pgm_read_byte(pair) == toupper(left) && pgm_read_byte(pair + 1) == toupper(right)) return -1;
+  }
+  return 0;
+}
+
+int textWidth(const char *text) {
+  int width = 0;
+  for(const char *c = text; *c; c++){
+    width += pgm_read_byte(propGlyphAdvance + propGlyphIndex(*c));
+    if(c[1]) width += propKerning(c[0], c[1]);
+  }
+  return max(width - 1, 0);  // no gap after the last glyph
+}
+
+int textRunStride(const char *text) {
+  return constrain((textWidth(text) + 7) / 8, 1, textRunMaxStride);
+}
+
+// Renders into stride * propHeight bytes; columns past the stride are dropped.
+void renderTextRun(const char *text, uint8_t *bits, int stride) {
+  memset(bits, 0, stride * propHeight);
+  int x = 0;
+  for(const char *c = text; *c; c++){
+    int glyph = propGlyphIndex(*c);
+    int from = pgm_read_word(propGlyphOffset + glyph), to = pgm_read_word(propGlyphOffset + glyph + 1);
+    for(int i = from; i < to; i++){
+      uint8_t column = pgm_read_byte(propGlyphs + i);
+      int px = x + i - from;
+      if(px >= stride * 8) break;
+      for(int row = 0; column; row++, column >>= 1){
+        if(column & 1) bits[row * stride + (px >> 3)] |= 0x80 >> (px & 7);
+      }
+    }
+    x += pgm_read_byte(propGlyphAdvance + glyph);
+    if(c[1]) x += propKerning(c[0], c[1]);
+  }
+}
+
+void drawText(int x, int y, const char *text, uint16_t color) {
+  uint8_t bits[textRunMaxStride * propHeight];
+  int stride = textRunStride(text);
+  renderTextRun(text, bits, stride);
+  graphics.drawBitmap(x, y, bits, stride * 8, propHeight, color);
+}
+
+// text must outlive the sketch (a literal or a const table entry).
+void drawStaticText(int x, int y, const char *text, uint16_t color) {
+  const TextRun *run = NULL;
+  for(int i = 0; i < textRunCount && !run; i++){
+    if(textRuns[i].text == text) run = &textRuns[i];
+  }
+  if(!run){
+    int stride = textRunStride(text);
+    size_t bytes = stride * propHeight;
+    if(textRunCount == textRunSlots || bytes > textRunPoolBytes - textRunPoolUsed){
+      drawText(x, y, text, color);
+      return;
+    }
+    TextRun &added = textRuns[textRunCount++];
+    added.text = text;
+    added.offset = textRunPoolUsed;
+    added.stride = stride;
+    renderTextRun(text, textRunPool + textRunPoolUsed, stride);
+    textRunPoolUsed += bytes;
+    run = &added;
+  }
+  graphics.drawBitmap(x, y, textRunPool + run->offset, run->stride * 8, propHeight, color);
+}
+
+// -------------------------------------------------------------------
+// Retained drawing
+// Widgets remember what they last put on screen so a frame only
+// repaints what changed. A full repaint of the background resets all
+// of them to notDrawn.
+struct ValueLabel {
+  int x, y;
+  const char *unit;
+  int drawnValue;
+  int drawnColor;
+};
+
+// Values on the secondary pages
+ValueLabel tripValues[] = {
+  { 80, 10, "M", notDrawn, notDrawn },  // trip time
+  { 80, 25, "C", notDrawn, notDrawn },  // max coolant
+  { 80, 40, "L", notDrawn, notDrawn },  // min fuel
+  { 80, 55, "L", notDrawn, notDrawn },  // fuel used
+};
+ValueLabel diagValues[] = {
+  { 80,  6, "US", notDrawn, notDrawn }, // frame time
+  { 80, 17, "US", notDrawn, notDrawn }, // layout load time
+  { 80, 28, "B",  notDrawn, notDrawn }, // page cache total
+  { 80, 39, "K",  notDrawn, notDrawn }, // free heap
+  { 80, 50, "K",  notDrawn, notDrawn }, // lowest free heap
+  { 80, 61, "K",  notDrawn, notDrawn }, // largest free block
+  { 80, 72, "K",  notDrawn, notDrawn }, // arena used
+  { 80, 83, "B",  notDrawn, notDrawn }, // least stack headroom
+};
+ValueLabel rawValues[] = {
+  { 80, 10, "", notDrawn, notDrawn },   // coolant raw
+  { 80, 25, "", notDrawn, notDrawn },   // coolant filtered
+  { 80, 40, "", notDrawn, notDrawn },   // fuel raw
+  { 80, 55, "", notDrawn, notDrawn },   // fuel filtered
+  { 80, 70, "", notDrawn, notDrawn },   // oil switch
+};
+ValueLabel histValues[] = {
+  { 80,  2, "", notDrawn, notDrawn },   // overruns
+};
+#if DUAL_VIDEO
+ValueLabel secondValues[] = {
+  { 80,  8, "M",  notDrawn, notDrawn }, // trip time
+  { 80, 20, "C",  notDrawn, notDrawn }, // max coolant
+  { 80, 32, "L",  notDrawn, notDrawn }, // min fuel
+  { 80, 44, "L",  notDrawn, notDrawn }, // fuel used
+  { 80, 56, "H",  notDrawn, notDrawn }, // engine hours
+  { 80, 68, "US", notDrawn, notDrawn }, // frame time
+  { 80, 80, "K",  notDrawn, notDrawn }, // lowest free heap
+};
+const int secondRowCount = sizeof(secondValues) / sizeof(secondValues[0]);
+int secondScreenBg = notDrawn;  // background of the second screen, notDrawn until its static layer is
+#endif
+int histDrawnHeight[histBuckets];
+
+int screenBg = notDrawn;  // background color currently on screen
+int selfTestRowState = notDrawn;
+
+void invalidateScreen() {
+#if ATTR_VIDEO
+  graphics.hideSprites();
+#endif
+  screenBg = notDrawn;
+  selfTestRowState = notDrawn;
+  for(int i = 0; i < widgetCount; i++){
+    Widget &w = widgets[i];
+    w.drawnHue = w.drawnWidth = w.drawnMarker = w.drawnValue = w.drawnColor = notDrawn;
+  }
+  for(ValueLabel &label : tripValues) label.drawnValue = notDrawn;
+  for(ValueLabel &label : diagValues) label.drawnValue = notDrawn;
+  for(ValueLabel &label : rawValues)  label.drawnValue = notDrawn;
+  for(ValueLabel &label : histValues) label.drawnValue = notDrawn;
+  for(int &height : histDrawnHeight)  height = notDrawn;
+}
+
+// Width of value and unit in print()'s font, to clear exactly what a
+// value put on screen (DIAG figures run to seven characters).
+int valueTextWidth(int value, const char *unit) {
+  char digits[12];
+  return (snprintf(digits, sizeof(digits), "%d", value) + (int)strlen(unit)) * fixedCharAdvance;
+}
+
+void drawValueAt(int x, int y, const char *unit, int value, int color, int &drawnValue, int &drawnColor,
+                 int bg = screenBg) {
+  if(value == drawnValue && color == drawnColor) return;
+  if(drawnValue != notDrawn){
+    graphics.fillRect(x, y, min(valueTextWidth(drawnValue, unit), screenWidth - x), 8, bg);
+  }
+  graphics.setCursor(x, y);
+  graphics.setHue(color);
+  graphics.print(String(value)+unit);
+  frameTextBuilds++;
+  drawnValue = value;
+  drawnColor = color;
+}
+
+void drawValue(ValueLabel &label, int value, int color) {
+  drawValueAt(label.x, label.y, label.unit, value, color, label.drawnValue, label.drawnColor);
+}
+
+// Big values are seven-segment digits: each segment is one fillRect,
+// so a digit costs at most seven rectangles and no glyph lookups, and
+// an update only paints the segments that toggled (lit ones in the
+// color, dark ones in the background). A color change repaints the
+// lit segments. Leading zeros are left dark; the unit follows in the
+// small font, top-aligned.
+struct SegmentRect {
+  int8_t x, y, w, h;
+};
+
+
+// Segments a..g in bits 0..6, for a 9x16 cell with 2-pixel strokes
+constexpr SegmentRect digitSegments[7] = {
+  { 2,  0, 5, 2 },  // a: top
+  { 7,  2, 2, 5 },  // b: upper right
+  { 7,  9, 2, 5 },  // c: lower right
+  { 2, 14, 5, 2 },  // d: bottom
+  { 0,  9, 2, 5 },  // e: lower left
+  { 0,  2, 2, 5 },  // f: upper left
+  { 2,  7, 5, 2 },  // g: middle
+};
+constexpr uint8_t digitSegmentMasks[10] = {
+  0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F,
+};
+
+// Segment masks of value right-aligned in digits cells, most
+// significant first; a value that does not fit shows all nines.
+void bigDigitMasks(int value, int digits, uint8_t *masks) {
+  int limit = 1;
+  for(int i = 0; i < digits; i++) limit *= 10;
+  value = constrain(value, 0, limit - 1);
+  for(int i = digits - 1; i >= 0; i--){
+    masks[i] = (value > 0 || i == digits - 1) ? digitSegmentMasks[value % 10] : 0;
+    value /= 10;
+  }
+}
+
+void drawBigValue(Widget &w, int value, int color) {
+  if(value == w.drawnValue && color == w.drawnColor) return;
+  uint8_t shown[bigDigitsMax], wanted[bigDigitsMax];
+  bool repaint = (w.drawnValue == notDrawn || color != w.drawnColor);
+  if(w.drawnValue != notDrawn) bigDigitMasks(w.drawnValue, w.style, shown);
+  else memset(shown, 0, sizeof(shown));
+  bigDigitMasks(value, w.style, wanted);
+
+  for(int i = 0; i < w.style; i++){
+    uint8_t on  = repaint ? wanted[i] : wanted[i] & ~shown[i];
+    uint8_t off = shown[i] & ~wanted[i];
+    for(int seg = 0; seg < 7; seg++){
+      const SegmentRect &r = digitSegments[seg];
+      int x = w.x + i * bigDigitAdvance + r.x, y = w.y + r.y;
+      if(on & (1 << seg)) graphics.fillRect(x, y, r.w, r.h, color);
+      else if(off & (1 << seg)) graphics.fillRect(x, y, r.w, r.h, screenBg);
+    }
+  }
+  if(color != w.drawnColor){
+    int x = w.x + w.style * bigDigitAdvance;
+    graphics.fillRect(x, w.y, bigUnitWidth, 8, screenBg);
+    graphics.setCursor(x, w.y);
+    graphics.setHue(color);
+    graphics.print(channelUnits[w.channel]);
+  }
+  w.drawnValue = value;
+  w.drawnColor = color;
+}
+
+uint16_t textColorOn(int bg) {
+  return (bg == WHITE) ? BLACK : WHITE;
+}
+
+void drawLabel(int x, int y, const char *text) {
+  drawStaticText(x, y, text, textColorOn(screenBg));
+}
+
+void drawIconWidget(Widget &w, int hue) {
+  if(hue == w.drawnHue) return;
+#if ATTR_VIDEO
+  if(w.drawnHue != notDrawn){
+    graphics.recolor(w.x, w.y, 16, 16, hue);  // the icon's cells take the new color
+    w.drawnHue = hue;
+    return;
+  }
+#endif
+  if(w.drawnHue != notDrawn) graphics.fillRect(w.x, w.y, 16, 16, screenBg);
+  graphics.drawBitmap(w.x, w.y, icons[w.style], 16, 16, hue);
+  w.drawnHue = hue;
+}
+
+// Paint the bar, touching only the columns that changed since last
+// frame. The outline comes from the page's static layer. A moving marker
+// repaints two columns: its old one (restored to fill or background)
+// and its new one; it is also put back if the fill just painted over it.
+void drawBarWidget(Widget &w, int hue) {
+  const BarGauge &bar = gauges[w.channel];
+  int width = map(barShownValue(bar), bar.valueMin, bar.valueMax, 0, barMaxWidth);
+  int x0 = w.x + 1, y0 = w.y + 1;
+  int paintedFrom = 0, paintedTo = 0;
+
+#if ATTR_VIDEO
+  if(w.drawnWidth != notDrawn && hue != w.drawnHue){
+    graphics.recolor(w.x, w.y, barMaxWidth + 2, 10, hue);
+    w.drawnHue = hue;
+  }
+#endif
+
+  if(w.drawnWidth == notDrawn){
+    if(width > 0) graphics.fillRect(x0, y0, width, 8, hue);
+    paintedTo = barMaxWidth;
+  } else if(hue != w.drawnHue){
+    if(width > 0) graphics.fillRect(x0, y0, width, 8, hue);
+    if(width < w.drawnWidth) graphics.fillRect(x0+width, y0, w.drawnWidth-width, 8, screenBg);
+    paintedTo = max(width, w.drawnWidth);
+  } else if(width > w.drawnWidth){
+    graphics.fillRect(x0+w.drawnWidth, y0, width-w.drawnWidth, 8, hue);
+    paintedFrom = w.drawnWidth;
+    paintedTo = width;
+  } else if(width < w.drawnWidth){
+    graphics.fillRect(x0+width, y0, w.drawnWidth-width, 8, screenBg);
+    paintedFrom = width;
+    paintedTo = w.drawnWidth;
+  }
+  w.drawnWidth = width;
+  w.drawnHue = hue;
+
+  if(!(w.style & BAR_MARKER)) return;
+  int col = constrain(map(markers[w.channel].value, bar.valueMin, bar.valueMax, 0, barMaxWidth), 0, barMaxWidth-1);
+#if ATTR_VIDEO
+  // A sprite: moving it leaves the bar's pixels and cells alone.
+  if(w.drawnMarker == notDrawn) graphics.setSprite(spriteMarker + w.channel, markerSprite, WHITE);
+  if(col != w.drawnMarker) graphics.moveSprite(spriteMarker + w.channel, x0 + col, y0);
+  w.drawnMarker = col;
+  return;
+#endif
+  int old = w.drawnMarker;
+  bool overwritten = (old >= paintedFrom && old < paintedTo);
+  if(col == old && !overwritten) return;
+
+  if(old != notDrawn && old != col && !overwritten){
+    graphics.fillRect(x0+old, y0, 1, 8, old < width ? hue : screenBg);
+  }
+  graphics.fillRect(x0+col, y0, 1, 8, WHITE);
+  w.drawnMarker = col;
+}
+
+void drawAlarmText(Widget &w, int color) {
+  if(color == w.drawnColor) return;
+  graphics.fillRect(w.x, w.y, textWidth(alarmTexts[w.style]), propHeight, screenBg);
+  if(color != notDrawn) drawStaticText(w.x, w.y, alarmTexts[w.style], color);
+  w.drawnColor = color;
+}
+
+void drawWidget(Widget &w, bool flash) {
+  bool critical = channelCritical(w.channel);
+  uint16_t textColor = (critical && flash) ? BLACK : WHITE;
+
+  switch(w.type){
+    case W_ICON:
+      drawIconWidget(w, channelHue(w.channel));
+      break;
+    case W_BAR:
+      drawBarWidget(w, channelHue(w.channel));
+      break;
+    case W_VALUE:
+      drawValueAt(w.x, w.y, channelUnits[w.channel], barShownValue(gauges[w.channel]),
+                  textColor, w.drawnValue, w.drawnColor);
+      break;
+    case W_ALARM_TEXT:
+      drawAlarmText(w, critical ? textColor : notDrawn);
+      break;
+    case W_BIG_VALUE:
+      drawBigValue(w, barShownValue(gauges[w.channel]), textColor);
+      break;
+  }
+}
+
+// -------------------------------------------------------------------
+// Memory
+// Buffers that live for the whole run (page caches, mirror and TFT
+// shadows) are carved from one static arena at boot instead of the heap,
+// so what they cost is one number and the heap only sees the libraries.
+// sampleMemory() fills memStats from the internal heap counters and the
+// stack high-water marks of our tasks; it is shown on the DIAG page,
+// printed by "mem" and sent as PKT_MEMORY (the struct as laid out here).
+struct __attribute__((packed)) MemoryStats {
+  uint32_t heapFree;          // internal RAM, bytes
+  uint32_t heapMinFree;       // lowest heapFree since boot
+  uint32_t heapLargestBlock;  // largest single allocation that would succeed
+  uint16_t arenaUsed, arenaBytes;
+  uint16_t stackLoop, stackWatchdog, stackCheckpoint;  // bytes never touched
+};
+
+uint8_t arena[arenaBytes] __attribute__((aligned(4)));
+size_t arenaUsed = 0;
+MemoryStats memStats;
+
+TaskHandle_t loopTaskHandle       = NULL;
+TaskHandle_t watchdogTaskHandle   = NULL;
+TaskHandle_t checkpointTaskHandle = NULL;
+
+// Never freed. Returns NULL once the arena is full; callers treat that
+// like a failed malloc.
+void *arenaAlloc(size_t bytes) {
+  bytes = (bytes + 3) & ~(size_t)3;
+  if(bytes > arenaBytes - arenaUsed) return NULL;
+  void *block = arena + arenaUsed;
+  arenaUsed += bytes;
+  return block;
+}
+
+// On the ESP32 the high-water mark is already in bytes.
+uint16_t stackHeadroom(TaskHandle_t task) {
+  return task ? saturate16(uxTaskGetStackHighWaterMark(task)) : 0;
+}
+
+void sampleMemory() {
+  memStats.heapFree         = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  memStats.heapMinFree      = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+  memStats.heapLargestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  memStats.arenaUsed        = arenaUsed;
+  memStats.arenaBytes       = arenaBytes;
+  memStats.stackLoop        = stackHeadroom(loopTaskHandle);
+  memStats.stackWatchdog    = stackHeadroom(watchdogTaskHandle);
+  memStats.stackCheckpoint  = stackHeadroom(checkpointTaskHandle);
+}
+
+// Tightest of the tasks that are running.
+uint16_t minStackHeadroom() {
+  uint16_t least = 0xFFFF;
+  const uint16_t marks[] = { memStats.stackLoop, memStats.stackWatchdog, memStats.stackCheckpoint };
+  for(uint16_t mark : marks) if(mark && mark < least) least = mark;
+  return least == 0xFFFF ? 0 : least;
+}
+
+// -------------------------------------------------------------------
+// Pages
+// Each page has a static layer (labels, outlines) and dynamic widgets.
+// The static layer of a page is snapshotted from the backbuffer the
+// first time it is drawn on the normal background, so switching back to
+// it is a row copy instead of a redraw. Snapshots larger than
+// pageCacheBudget are not kept and the static layer is redrawn instead.
+struct Page {
+  const char *name;
+  int staticTop, staticRows;  // rows the static layer occupies
+  void (*drawStatic)();
+  void (*drawDynamic)(bool flash);
+  char *cache;
+  bool cacheValid;
+};
+
+unsigned long frameTimeUs = 0;
+unsigned long frameMaxUs  = 0;
+
+void drawMainStatic() {
+  for(int i = 0; i < widgetCount; i++){
+    if(widgets[i].type == W_BAR) graphics.drawRect(widgets[i].x, widgets[i].y, barMaxWidth+2, 10, 0);
+  }
+}
+
+void drawSelfTestRow();
+
+void drawMainDynamic(bool flash) {
+  for(int i = 0; i < widgetCount; i++) drawWidget(widgets[i], flash);
+  drawSelfTestRow();
+}
+
+void drawTripStatic() {
+  drawLabel(0, 10, "TRIP TIME");
+  drawLabel(0, 25, "MAX TEMP");
+  drawLabel(0, 40, "MIN FUEL");
+  drawLabel(0, 55, "FUEL USED");
+}
+
+void drawTripDynamic(bool flash) {
+  uint16_t color = textColorOn(screenBg);
+  drawValue(tripValues[0], (millis() - trip.startMs) / 60000, color);
+  drawValue(tripValues[1], trip.maxCoolantC, color);
+  drawValue(tripValues[2], trip.minFuelLiters, color);
+  drawValue(tripValues[3], max(trip.startFuelLiters - sensors.fuelLiters, 0), color);
+}
+
+size_t pageCacheBytes();
+
+void drawDiagStatic() {
+  drawLabel(0,  6, "FRAME");
+  drawLabel(0, 17, "LAYOUT");
+  drawLabel(0, 28, "CACHE");
+  drawLabel(0, 39, "HEAP");
+  drawLabel(0, 50, "HEAP MIN");
+  drawLabel(0, 61, "BLOCK");
+  drawLabel(0, 72, "ARENA");
+  drawLabel(0, 83, "STACK");
+}
+
+void drawDiagDynamic(bool flash) {
+  uint16_t color = textColorOn(screenBg);
+  drawValue(diagValues[0], frameTimeUs, color);
+  drawValue(diagValues[1], layoutLoadUs, color);
+  drawValue(diagValues[2], pageCacheBytes(), color);
+  drawValue(diagValues[3], memStats.heapFree / 1024, color);
+  drawValue(diagValues[4], memStats.heapMinFree / 1024, color);
+  drawValue(diagValues[5], memStats.heapLargestBlock / 1024, color);
+  drawValue(diagValues[6], memStats.arenaUsed / 1024, color);
+  drawValue(diagValues[7], minStackHeadroom(), color);
+}
+
+void drawRawStatic() {
+  drawLabel(0, 10, "TEMP RAW");
+  drawLabel(0, 25, "TEMP FILT");
+  drawLabel(0, 40, "FUEL RAW");
+  drawLabel(0, 55, "FUEL FILT");
+  drawLabel(0, 70, "OIL PIN");
+}
+
+void drawRawDynamic(bool flash) {
+  uint16_t color = textColorOn(screenBg);
+  drawValue(rawValues[0], sensors.coolantRaw, color);
+  drawValue(rawValues[1], sensors.coolantADC, color);
+  drawValue(rawValues[2], sensors.fuelRaw, color);
+  drawValue(rawValues[3], sensors.fuelADC, color);
+  drawValue(rawValues[4], sensors.oilCritical ? HIGH : LOW, color);
+}
+
+// Frame-time histogram: one column per bucket, scaled to the fullest.
+// Only the part of a column that grew or shrank is repainted.
+const int histLeft = 8, histPitch = 7, histBarWidth = 6;
+const int histBaseY = 80, histBarMax = 64;
+
+void drawHistStatic() {
+  uint16_t color = textColorOn(screenBg);
+  drawLabel(0, 2, "OVERRUNS");
+  graphics.fillRect(histLeft, histBaseY, histBuckets * histPitch - 1, 1, color);
+  graphics.fillRect(histLeft + histBucket(frameBudgetUs) * histPitch, histBaseY + 1, histBarWidth, 2, color);
+  drawLabel(histLeft, 86, "1US");
+  drawLabel(histLeft + 10 * histPitch, 86, "1MS");
+}
+
+void drawHistDynamic(bool flash) {
+  uint16_t color = textColorOn(screenBg);
+  drawValue(histValues[0], frameOverruns, color);
+
+  uint32_t most = 1;
+  for(uint32_t count : frameHist) most = max(most, count);
+  for(int i = 0; i < histBuckets; i++){
+    int height = frameHist[i] ? max(1, (int)((uint64_t)frameHist[i] * histBarMax / most)) : 0;
+    int drawn = max(histDrawnHeight[i], 0);
+    if(height == histDrawnHeight[i]) continue;
+    int x = histLeft + i * histPitch;
+    if(height > drawn) graphics.fillRect(x, histBaseY - height, histBarWidth, height - drawn, color);
+    else if(height < drawn) graphics.fillRect(x, histBaseY - drawn, histBarWidth, drawn - height, screenBg);
+    histDrawnHeight[i] = height;
+  }
+}
+
+Page pages[] = {
+  { "GAUGES", 30, 30, drawMainStatic,  drawMainDynamic,  NULL, false },
+  { "TRIP",   10, 53, drawTripStatic,  drawTripDynamic,  NULL, false },
+  { "DIAG",    6, 85, drawDiagStatic,  drawDiagDynamic,  NULL, false },
+  { "RAW",    10, 68, drawRawStatic,   drawRawDynamic,   NULL, false },
+  { "HIST",    2, 87, drawHistStatic,  drawHistDynamic,  NULL, false },
+};
+const int pageCount = sizeof(pages) / sizeof(pages[0]);
+int currentPage = 0;
+
+size_t pageStaticBytes(const Page &page) {
+  return (size_t)page.staticRows * screenWidth;
+}
+
+size_t pageCacheBytes() {
+  size_t total = 0;
+  for(const Page &page : pages) if(page.cache) total += pageStaticBytes(page);
+  return total;
+}
+
+// The gauge page's static rows follow its bars, wherever the layout put them.
+void fitMainPageToLayout() {
+  int top = screenHeight, bottom = 0;
+  for(int i = 0; i < widgetCount; i++){
+    if(widgets[i].type != W_BAR) continue;
+    top = min(top, (int)widgets[i].y);
+    bottom = max(bottom, widgets[i].y + 10);
+  }
+  pages[0].staticTop  = (bottom > top) ? top : 0;
+  pages[0].staticRows = (bottom > top) ? min(bottom, screenHeight) - top : 0;
+}
+
+void allocatePageCaches() {
+  for(Page &page : pages){
+    size_t bytes = pageStaticBytes(page);
+    if(bytes <= pageCacheBudget && !ATTR_VIDEO) page.cache = (char *)arenaAlloc(bytes);
+    Serial.printf("page %-6s static %5u B  %s\n", page.name, (unsigned)bytes,
+                  page.cache ? "cached" : "over budget, redrawn");
+  }
+  Serial.printf("page cache total %u B (budget %u B/page), arena %u/%u B\n",
+                (unsigned)pageCacheBytes(), (unsigned)pageCacheBudget,
+                (unsigned)arenaUsed, (unsigned)arenaBytes);
+}
+
+// Rows are copied straight from/to the library's backbuffer (char rows
+// of screenWidth color values). Attribute video has no such rows and
+// always redraws the static layer.
+void drawPageStatic(Page &page, uint16_t bg) {
+  invalidateScreen();
+  graphics.fillScreen(bg);
+  screenBg = bg;
+
+#if !ATTR_VIDEO
+  bool cacheable = page.cache && bg == DARKBLUE;
+  if(cacheable && page.cacheValid){
+    for(int row = 0; row < page.staticRows; row++)
+      memcpy(graphics.backbuffer[page.staticTop + row], page.cache + row * screenWidth, screenWidth);
+    return;
+  }
+  page.drawStatic();
+  if(cacheable){
+    for(int row = 0; row < page.staticRows; row++)
+      memcpy(page.cache + row * screenWidth, graphics.backbuffer[page.staticTop + row], screenWidth);
+    page.cacheValid = true;
+  }
+#else
+  page.drawStatic();
+#endif
+}
+
+void drawBackground(bool warningMode, bool flash) {
+  uint16_t bg = (warningMode && flash) ? WHITE : DARKBLUE;
+  if(bg == screenBg) return;
+  drawPageStatic(pages[currentPage], bg);
+}
+
+void nextPage() {
+  currentPage = (currentPage + 1) % pageCount;
+  screenBg = notDrawn;  // next drawBackground() brings in the new page
+}
+
+// -------------------------------------------------------------------
+// Night mode
+// Switching palettes never redraws widgets. The UI colors are swapped
+// and every pixel already on screen (and in the page caches) is passed
+// once through a precomputed 256-entry remap table, along with the
+// colors the widgets remember having drawn. Values that are not UI
+// colors pass through unchanged; channelHue() never returns a UI
+// background or white, so icons and bars are never caught by the remap.
+uint8_t dayToNight[256];
+uint8_t nightToDay[256];
+bool nightMode = false;
+
+void buildRemap(uint8_t lut[256], const UiPalette &from, const UiPalette &to) {
+  for(int i = 0; i < 256; i++) lut[i] = i;
+  lut[from.background] = to.background;
+  lut[from.white]      = to.white;
+  lut[from.black]      = to.black;
+}
+
+void buildNightRemaps() {
+  buildRemap(dayToNight, dayPalette, nightPalette);
+  buildRemap(nightToDay, nightPalette, dayPalette);
+}
+
+int remapColor(const uint8_t lut[256], int color) {
+  return (color == notDrawn) ? notDrawn : lut[(uint8_t)color];
+}
+
+void remapRows(const uint8_t lut[256], char *row, int count) {
+  for(int i = 0; i < count; i++) row[i] = lut[(uint8_t)row[i]];
+}
+
+void applyPalette(const UiPalette &to, const uint8_t lut[256]) {
+#if ATTR_VIDEO
+  graphics.remapColors(lut);
+#else
+  for(int y = 0; y < screenHeight; y++) remapRows(lut, graphics.backbuffer[y], screenWidth);
+#endif
+  for(Page &page : pages){
+    if(page.cacheValid) remapRows(lut, page.cache, page.staticRows * screenWidth);
+  }
+
+  screenBg = remapColor(lut, screenBg);
+  for(int i = 0; i < widgetCount; i++){
+    widgets[i].drawnColor = remapColor(lut, widgets[i].drawnColor);
+  }
+  for(ValueLabel &label : tripValues) label.drawnColor = remapColor(lut, label.drawnColor);
+  for(ValueLabel &label : diagValues) label.drawnColor = remapColor(lut, label.drawnColor);
+  for(ValueLabel &label : rawValues)  label.drawnColor = remapColor(lut, label.drawnColor);
+  for(ValueLabel &label : histValues) label.drawnColor = remapColor(lut, label.drawnColor);
+#if DUAL_VIDEO
+  secondScreenBg = remapColor(lut, secondScreenBg);
+  for(ValueLabel &label : secondValues) label.drawnColor = remapColor(lut, label.drawnColor);
+#endif
+
+  DARKBLUE = to.background;
+  WHITE    = to.white;
+  BLACK    = to.black;
+}
+
+// Hysteresis: the ambient level has to cross the far threshold and stay
+// there for nightSwitchMs before the palette flips.
+void updateNightMode() {
+  static unsigned long pastThresholdSince = 0;
+  bool wantNight = nightMode ? (sensors.ambientADC < ambientDayADC)
+                             : (sensors.ambientADC < ambientNightADC);
+  unsigned long now = millis();
+
+  if(wantNight == nightMode){
+    pastThresholdSince = now;
+    return;
+  }
+  if(now - pastThresholdSince < nightSwitchMs) return;
+
+  nightMode = wantNight;
+  if(nightMode) applyPalette(nightPalette, dayToNight);
+  else          applyPalette(dayPalette, nightToDay);
+}
+
+// -------------------------------------------------------------------
+// Audible alarms
+// A tone pattern is a 32-step on/off mask played at one frequency, one
+// step every toneStepMs. Hardware timer 1 advances the step and gates
+// the LEDC duty from its ISR, so sequencing never waits on the loop and
+// the loop never waits on a tone. Priority: oil > coolant > low fuel.
+struct TonePattern {
+  uint16_t freqHz;
+  uint32_t mask;    // bit n set = tone on during step n
+  bool repeat;      // one-shot patterns stop after step 31
+};
+
+const int buzzerChannel       = 0;   // LEDC channel
+const int buzzerResolution    = 10;  // bits
+const uint32_t buzzerDutyOn   = 1 << (buzzerResolution - 1);  // 50%
+const int toneTimer           = 1;   // hardware timer
+const unsigned long toneStepMs = 50; // 32 steps = 1.6 s per pattern
+
+const TonePattern oilTone     = { 2800, 0x00000333, true  }; // urgent triple beep
+const TonePattern coolantTone = { 2000, 0x0000000F, true  }; // one beep per cycle
+const TonePattern fuelTone    = { 1500, 0x0000003F, false }; // single chime
+
+hw_timer_t *toneTimerHandle = NULL;
+const TonePattern *volatile activeTone = NULL;
+volatile uint8_t toneStep = 0;
+
+bool toneOn(const TonePattern &pattern, uint8_t step) {
+  return (pattern.mask >> step) & 1;
+}
+
+void IRAM_ATTR onToneStep() {
+  const TonePattern *pattern = activeTone;
+  if(!pattern) return;
+  uint8_t step = (toneStep + 1) & 31;
+  if(step == 0 && !pattern->repeat){
+    activeTone = NULL;
+    ledcWrite(buzzerChannel, 0);
+    return;
+  }
+  toneStep = step;
+  ledcWrite(buzzerChannel, toneOn(*pattern, step) ? buzzerDutyOn : 0);
+}
+
+void beginAlarmSound() {
+  ledcSetup(buzzerChannel, 2000, buzzerResolution);
+  ledcAttachPin(buzzerPin, buzzerChannel);
+  ledcWrite(buzzerChannel, 0);
+
+  toneTimerHandle = timerBegin(toneTimer, 80, true);  // 1 MHz
+  timerAttachInterrupt(toneTimerHandle, &onToneStep, true);
+  timerAlarmWrite(toneTimerHandle, toneStepMs * 1000, true);
+  timerAlarmEnable(toneTimerHandle);
+}
+
+// Called from the loop only when the wanted pattern changes. The timer
+// is paused while the LEDC frequency is reprogrammed so the ISR never
+// sees a half-switched pattern.
+void playTone(const TonePattern *pattern) {
+  timerAlarmDisable(toneTimerHandle);
+  activeTone = NULL;
+  ledcWrite(buzzerChannel, 0);
+  if(pattern){
+    ledcWriteTone(buzzerChannel, pattern->freqHz);
+    ledcWrite(buzzerChannel, toneOn(*pattern, 0) ? buzzerDutyOn : 0);
+    toneStep = 0;
+    activeTone = pattern;
+  }
+  timerAlarmEnable(toneTimerHandle);
+}
+
+void updateAlarmSound() {
+  static const TonePattern *wanted = NULL;
+  static bool fuelChimed = false;
+
+  if(!sensors.fuelCritical) fuelChimed = false;
+
+  // The chime plays once per entry into the critical range and is left
+  // to finish on its own.
+  bool chime = sensors.fuelCritical && (!fuelChimed || activeTone == &fuelTone);
+
+  const TonePattern *next = NULL;
+  if(sensors.oilCritical)          next = &oilTone;
+  else if(sensors.coolantCritical) next = &coolantTone;
+  else if(chime)                   next = &fuelTone;
+
+  if(next == wanted) return;
+  wanted = next;
+  if(next == &fuelTone) fuelChimed = true;
+  if(next || activeTone) playTone(next);
+}
+
+// -------------------------------------------------------------------
+// Glow button
+// A short press (released before longPressMs) starts the glow plug,
+// holding the button switches page as soon as longPressMs is reached.
+enum ButtonEvent { BUTTON_NONE, BUTTON_SHORT, BUTTON_LONG };
+
+ButtonEvent readGlowButton() {
+  static bool pressed = false;
+  static bool longFired = false;
+  static unsigned long pressedAt = 0;
+
+  bool down = (digitalRead(glowButtonPin) == LOW);
+  unsigned long now = millis();
+
+  if(down && !pressed){
+    pressed = true;
+    longFired = false;
+    pressedAt = now;
+  } else if(down && !longFired && now - pressedAt >= longPressMs){
+    longFired = true;
+    return BUTTON_LONG;
+  } else if(!down && pressed){
+    pressed = false;
+    if(!longFired) return BUTTON_SHORT;
+  }
+  return BUTTON_NONE;
+}
+
+// -------------------------------------------------------------------
+// Glow plug handling
+void drawGlowScreen(int remainingSeconds) {
+  invalidateScreen();
+  graphics.fillScreen(WHITE);
+  graphics.setHue(BLACK);
+  graphics.setCursor(50,40);
+  graphics.print(remainingSeconds);
+#if ATTR_VIDEO
+  graphics.setSprite(spriteGlow, glowIcon, 1);  // blinks in the scanout
+  graphics.moveSprite(spriteGlow, 110, 0);
+  if(!flashState) graphics.hideSprite(spriteGlow);
+#else
+  graphics.drawBitmap(110,0,glowIcon,16,16,1);
+#endif
+}
+
+void handleGlowPlug(bool startRequested) {
+  static bool glowActive = false;
+  static unsigned long glowStartTime = 0;
+  static int glowDuration = 0;
+
+  // Coolant temperature sets the glow duration
+  int coolantC = sensors.coolantC;
+
+  if(!glowActive && startRequested){
+    glowActive = true;
+    glowDuration = map(coolantC, glowTempMin, glowTempMax, glowMaxTime, glowMinTime);
+    glowDuration = constrain(glowDuration, glowMinTime, glowMaxTime);
+    glowStartTime = millis();
+    digitalWrite(glowPin, HIGH);
+  }
+
+  if(glowActive){
+    int elapsed = (millis() - glowStartTime)/1000;
+    int remaining = glowDuration - elapsed;
+    if(remaining <= 0){
+      glowActive = false;
+      digitalWrite(glowPin, LOW);
+    } else {
+      drawGlowScreen(remaining);
+    }
+  }
+}
+
+// -------------------------------------------------------------------
+// Boot self-test
+// Times the hot paths once at boot and compares them with baselines kept
+// in NVS (the first run stores them). A check fails when it is more than
+// selfTestSlackPct slower than its baseline, or when the hardware check
+// itself fails. Results go to Serial and to a row of two-letter cells at
+// the bottom of the safe area of the gauge page for selfTestShowMs.
+struct SelfTestResult {
+  const char *label;   // shown on screen
+  const char *key;     // NVS baseline key
+  unsigned long us;
+  unsigned long baselineUs;
+  bool ok;             // hardware check passed
+  bool pass;
+};
+
+SelfTestResult selfTests[] = {
+  { "CT", "adcCool", 0, 0, true, true },  // coolant ADC sample
+  { "FL", "adcFuel", 0, 0, true, true },  // fuel ADC sample
+  { "AM", "adcAmb",  0, 0, true, true },  // ambient ADC sample
+  { "FR", "frame",   0, 0, true, true },  // full gauge page render
+  { "IC", "icon",    0, 0, true, true },  // 16x16 icon blit
+  { "GL", "glow",    0, 0, true, true },  // glow output toggle
+};
+const int selfTestCount = sizeof(selfTests) / sizeof(selfTests[0]);
+const int selfTestCellWidth = safeSize(screenWidth) / selfTestCount;
+static_assert(selfTestCellWidth >= 2 * fixedCharAdvance, "self-test cells too narrow for their labels");
+bool selfTestPassed = true;
+
+unsigned long timeAnalogRead(int pin) {
+  const int samples = 16;
+  unsigned long start = micros();
+  for(int i = 0; i < samples; i++) analogRead(pin);
+  return (micros() - start) / samples;
+}
+
+unsigned long timeFullRender() {
+  unsigned long start = micros();
+  drawPageStatic(pages[0], DARKBLUE);
+  drawMainDynamic(false);
+  return micros() - start;
+}
+
+unsigned long timeIconBlit() {
+  const int blits = 8;
+  unsigned long start = micros();
+  for(int i = 0; i < blits; i++) graphics.drawBitmap(0, 0, oilIcon, 16, 16, 5);
+  unsigned long us = (micros() - start) / blits;
+  invalidateScreen();
+  return us;
+}
+
+// Pulses the glow output and checks it reads back, and that current
+// flows if a sense input is fitted. The pulse is far too short to heat
+// the plugs.
+unsigned long timeGlowToggle(bool &ok) {
+  unsigned long start = micros();
+  digitalWrite(glowPin, HIGH);
+  ok = (digitalRead(glowPin) == HIGH);
+  while(micros() - start < glowPulseUs){}
+  if(glowSensePin >= 0 && analogRead(glowSensePin) < glowSenseMinADC) ok = false;
+  unsigned long toggleStart = micros();
+  digitalWrite(glowPin, LOW);
+  unsigned long us = micros() - toggleStart;
+  ok = ok && (digitalRead(glowPin) == LOW);
+  return us;
+}
+
+void runSelfTest() {
+  selfTests[0].us = timeAnalogRead(coolantPin);
+  selfTests[1].us = timeAnalogRead(fuelPin);
+  selfTests[2].us = timeAnalogRead(ambientPin);
+  selfTests[3].us = timeFullRender();
+  selfTests[4].us = timeIconBlit();
+  selfTests[5].us = timeGlowToggle(selfTests[5].ok);
+
+  Preferences baselines;
+  baselines.begin("selftest", false);
+  selfTestPassed = true;
+  for(SelfTestResult &test : selfTests){
+    test.baselineUs = baselines.getULong(test.key, 0);
+    if(test.baselineUs == 0){
+      test.baselineUs = test.us;
+      baselines.putULong(test.key, test.us);
+    }
+    unsigned long limit = test.baselineUs + test.baselineUs * selfTestSlackPct / 100 + selfTestSlackUs;
+    test.pass = test.ok && test.us <= limit;
+    selfTestPassed = selfTestPassed && test.pass;
+    Serial.printf("selftest %-7s %6lu us  base %6lu  %s\n", test.key, test.us, test.baselineUs,
+                  test.pass ? "PASS" : "FAIL");
+  }
+  baselines.end();
+}
+
+void drawSelfTestRow() {
+  int state = (millis() < selfTestShowMs) ? 1 : 0;
+  if(state == selfTestRowState) return;
+  int y = snapToCell(screenHeight - safeMargin(screenHeight) - 8);
+  graphics.fillRect(0, y, screenWidth, 8, screenBg);
+  if(state){
+    for(int i = 0; i < selfTestCount; i++){
+      graphics.setCursor(safeMargin(screenWidth) + i * selfTestCellWidth, y);
+      graphics.setHue(selfTests[i].pass ? 120 : 0); // green / red
+      graphics.print(selfTests[i].label);
+    }
+    if(lastStall.magic == stallMagic){
+      graphics.setCursor(safeMargin(screenWidth), y - 8);
+      graphics.setHue(0);
+      graphics.print("STALL ");
+      graphics.print(subsystemNames[lastStall.subsystem]);
+      graphics.print(" ");
+      graphics.print(probeNames[lastStall.probe]);
+    }
+  } else {
+    graphics.fillRect(0, y - 8, screenWidth, 8, screenBg);
+  }
+  selfTestRowState = state;
+}
+
+// -------------------------------------------------------------------
+// Telemetry
+// Snapshots go out on UART2 as COBS-encoded frames terminated by 0x00:
+//   COBS( type, payload..., crc16_lo, crc16_hi ) 0x00
+// The CRC is CRC-16/CCITT-FALSE over type and payload; multi-byte fields
+// are little-endian. A decoder resynchronises on the next 0x00 after a
+// bad frame; tools/dashlink.py is the host one, and tools/telemetry.py
+// prints the snapshots.
+//
+// Frames are handed to the UART driver's TX ring buffer, which the UART
+// interrupt drains into the hardware FIFO. A frame is only written when
+// the ring has room for all of it; otherwise it is dropped and counted,
+// so the loop never waits on the serial port.
+const long telemetryBaud        = 921600;
+const size_t telemetryRingBytes = 4096;
+
+enum PacketType : uint8_t {
+  PKT_SNAPSHOT     = 1,
+  PKT_MIRROR_KEY   = 2,  // viewer clears its frame to zero
+  PKT_MIRROR_TILE  = 3,  // tile delta against the viewer's frame
+  PKT_MIRROR_FRAME = 4,  // every tile has been scanned once since the last one
+  PKT_MEMORY       = 5,  // MemoryStats, once per memoryPeriodUs
+};
+
+enum SnapshotFlags : uint8_t {
+  SNAP_OIL_CRITICAL     = 0x01,
+  SNAP_COOLANT_CRITICAL = 0x02,
+  SNAP_FUEL_CRITICAL    = 0x04,
+  SNAP_NIGHT            = 0x08,
+  SNAP_GLOW_ON          = 0x10,
+  SNAP_TONE_ACTIVE      = 0x20,
+};
+
+struct __attribute__((packed)) TelemetrySnapshot {
+  uint16_t seq;
+  uint32_t timeUs;
+  uint16_t coolantRaw, coolantADC;
+  uint16_t fuelRaw, fuelADC;
+  uint16_t ambientADC;
+  int16_t  coolantC;
+  int16_t  fuelLiters;
+  uint8_t  flags;       // SnapshotFlags
+  uint8_t  page;
+  uint16_t frameTimeUs; // saturated
+  uint16_t frameMaxUs;  // saturated
+  uint16_t dropped;     // frames dropped for lack of TX space
+};
+
+const size_t maxPacketPayload = 160;
+uint16_t telemetrySeq = 0;
+uint16_t telemetryDropped = 0;
+
+uint16_t crc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  while(len--){
+    crc ^= (uint16_t)*data++ << 8;
+    for(int bit = 0; bit < 8; bit++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+// Writes at most len + len/254 + 1 bytes to out.
+size_t cobsEncode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t write = 1, codeIndex = 0;
+  uint8_t code = 1;
+  for(size_t read = 0; read < len; read++){
+    if(in[read] == 0){
+      out[codeIndex] = code;
+      code = 1;
+      codeIndex = write++;
+    } else {
+      out[write++] = in[read];
+      if(++code == 0xFF){
+        out[codeIndex] = code;
+        code = 1;
+        codeIndex = write++;
+      }
+    }
+  }
+  out[codeIndex] = code;
+  return write;
+}
+
+bool sendPacket(uint8_t type, const void *payload, size_t len) {
+  uint8_t raw[1 + maxPacketPayload + 2];
+  uint8_t frame[sizeof(raw) + sizeof(raw) / 254 + 2];
+  if(len > maxPacketPayload) return false;
+
+  raw[0] = type;
+  if(len) memcpy(raw + 1, payload, len);
+  uint16_t crc = crc16(raw, len + 1);
+  raw[len + 1] = crc & 0xFF;
+  raw[len + 2] = crc >> 8;
+
+  size_t n = cobsEncode(raw, len + 3, frame);
+  frame[n++] = 0;
+  if((size_t)Serial2.availableForWrite() < n){
+    telemetryDropped++;
+    return false;
+  }
+  Serial2.write(frame, n);
+  return true;
+}
+
+void beginTelemetry() {
+  Serial2.setTxBufferSize(telemetryRingBytes);
+  Serial2.begin(telemetryBaud, SERIAL_8N1, -1, telemetryTxPin);
+}
+
+void sendSnapshot() {
+  TelemetrySnapshot snap;
+  snap.seq         = telemetrySeq++;
+  snap.timeUs      = micros();
+  snap.coolantRaw  = sensors.coolantRaw;
+  snap.coolantADC  = sensors.coolantADC;
+  snap.fuelRaw     = sensors.fuelRaw;
+  snap.fuelADC     = sensors.fuelADC;
+  snap.ambientADC  = sensors.ambientADC;
+  snap.coolantC    = sensors.coolantC;
+  snap.fuelLiters  = sensors.fuelLiters;
+  snap.flags       = (sensors.oilCritical     ? SNAP_OIL_CRITICAL     : 0)
+                   | (sensors.coolantCritical ? SNAP_COOLANT_CRITICAL : 0)
+                   | (sensors.fuelCritical    ? SNAP_FUEL_CRITICAL    : 0)
+                   | (nightMode               ? SNAP_NIGHT            : 0)
+                   | (digitalRead(glowPin)    ? SNAP_GLOW_ON          : 0)
+                   | (activeTone              ? SNAP_TONE_ACTIVE      : 0);
+  snap.page        = currentPage;
+  snap.frameTimeUs = saturate16(frameTimeUs);
+  snap.frameMaxUs  = saturate16(frameMaxUs);
+  snap.dropped     = telemetryDropped;
+  sendPacket(PKT_SNAPSHOT, &snap, sizeof(snap));
+}
+
+// -------------------------------------------------------------------
+// Frame rows
+// The mirror and the TFT read the screen as rows of color values. With
+// CompositeGraphics that is the backbuffer itself; attribute video
+// expands rows into a small cache on demand, emptied by
+// frameRowsChanged() once drawing for the frame is done.
+#if ATTR_VIDEO
+const int frameRowCacheRows = 8;  // one tile or strip
+char frameRowCache[frameRowCacheRows][screenWidth];
+int frameRowCached[frameRowCacheRows];
+#endif
+
+const char *frameRow(int y) {
+#if ATTR_VIDEO
+  int slot = y % frameRowCacheRows;
+  if(frameRowCached[slot] != y){
+    graphics.expandRow(y, frameRowCache[slot]);
+    frameRowCached[slot] = y;
+  }
+  return frameRowCache[slot];
+#else
+  return graphics.backbuffer[y];
+#endif
+}
+
+void frameRowsChanged() {
+#if ATTR_VIDEO
+  for(int &y : frameRowCached) y = notDrawn;
+#endif
+}
+
+// -------------------------------------------------------------------
+// Framebuffer mirror
+// The viewer (tools/mirror_view.py) keeps a copy of the frame; we keep a
+// shadow of what it has.
+// Each display frame continues a scan over the tiles. A tile whose
+// pixels differ from the shadow is sent as its XOR with the shadow,
+// run-length encoded as (count, value) pairs, or raw when RLE would be
+// longer. Packets:
+//   PKT_MIRROR_KEY   { width, height, tileWidth, tileHeight }  (uint8 each)
+//   PKT_MIRROR_TILE  { tile, encoding (0 raw / 1 rle), data... }
+//   PKT_MIRROR_FRAME { }
+// The scan stops when mirrorSliceUs is used up or the TX ring is full,
+// and carries on from the same tile next frame.
+const int mirrorTilesX    = screenWidth / mirrorTileWidth;
+const int mirrorTilesY    = screenHeight / mirrorTileHeight;
+const int mirrorTileCount = mirrorTilesX * mirrorTilesY;
+const int mirrorTileBytes = mirrorTileWidth * mirrorTileHeight;
+
+enum TileEncoding : uint8_t { TILE_RAW = 0, TILE_RLE = 1 };
+
+char *mirrorShadow = NULL;
+int mirrorNextTile = 0;
+unsigned long mirrorKeyAt = 0;
+
+void beginMirror() {
+  if(!mirrorEnabled) return;
+  mirrorShadow = (char *)arenaAlloc(screenWidth * screenHeight);  // arena starts zeroed
+  mirrorKeyAt = millis() - mirrorKeyframeMs;  // key on the first frame
+}
+
+// Returns the RLE length, or 0 if it would not beat raw.
+size_t rleEncode(const uint8_t *in, size_t len, uint8_t *out, size_t outMax) {
+  size_t n = 0;
+  for(size_t i = 0; i < len; ){
+    uint8_t value = in[i];
+    size_t run = 1;
+    while(i + run < len && in[i + run] == value && run < 255) run++;
+    if(n + 2 > outMax) return 0;
+    out[n++] = run;
+    out[n++] = value;
+    i += run;
+  }
+  return n < len ? n : 0;
+}
+
+// Encodes the tile's delta into payload; returns 0 if the tile is unchanged.
+size_t encodeMirrorTile(int tile, uint8_t *payload) {
+  uint8_t delta[mirrorTileBytes];
+  int x0 = (tile % mirrorTilesX) * mirrorTileWidth;
+  int y0 = (tile / mirrorTilesX) * mirrorTileHeight;
+  uint8_t changed = 0;
+
+  for(int row = 0; row < mirrorTileHeight; row++){
+    const char *live   = frameRow(y0 + row) + x0;
+    const char *shadow = mirrorShadow + (y0 + row) * screenWidth + x0;
+    for(int col = 0; col < mirrorTileWidth; col++){
+      uint8_t d = live[col] ^ shadow[col];
+      delta[row * mirrorTileWidth + col] = d;
+      changed |= d;
+    }
+  }
+  if(!changed) return 0;
+
+  payload[0] = tile;
+  size_t rle = rleEncode(delta, mirrorTileBytes, payload + 2, maxPacketPayload - 2);
+  if(rle){
+    payload[1] = TILE_RLE;
+    return rle + 2;
+  }
+  payload[1] = TILE_RAW;
+  memcpy(payload + 2, delta, mirrorTileBytes);
+  return mirrorTileBytes + 2;
+}
+
+void commitMirrorTile(int tile) {
+  int x0 = (tile % mirrorTilesX) * mirrorTileWidth;
+  int y0 = (tile / mirrorTilesX) * mirrorTileHeight;
+  for(int row = 0; row < mirrorTileHeight; row++){
+    memcpy(mirrorShadow + (y0 + row) * screenWidth + x0, frameRow(y0 + row) + x0, mirrorTileWidth);
+  }
+}
+
+void mirrorFrame() {
+  if(!mirrorShadow) return;
+  unsigned long start = micros();
+
+  if(millis() - mirrorKeyAt >= mirrorKeyframeMs){
+    const uint8_t key[] = { screenWidth, screenHeight, mirrorTileWidth, mirrorTileHeight };
+    if(!sendPacket(PKT_MIRROR_KEY, key, sizeof(key))) return;
+    memset(mirrorShadow, 0, screenWidth * screenHeight);
+    mirrorNextTile = 0;
+    mirrorKeyAt = millis();
+  }
+
+  uint8_t payload[maxPacketPayload];
+  while(micros() - start < mirrorSliceUs){
+    size_t len = encodeMirrorTile(mirrorNextTile, payload);
+    if(len){
+      // Worst-case COBS frame for this payload; stop rather than drop.
+      if((size_t)Serial2.availableForWrite() < len + len / 254 + 5) return;
+      sendPacket(PKT_MIRROR_TILE, payload, len);
+      commitMirrorTile(mirrorNextTile);
+    }
+    if(++mirrorNextTile == mirrorTileCount){
+      mirrorNextTile = 0;
+      sendPacket(PKT_MIRROR_FRAME, NULL, 0);
+      return;
+    }
+  }
+}
+
+// -------------------------------------------------------------------
+// SPI TFT mirror
+// Shows the same screen on a small SPI TFT alongside composite output.
+// Each frame the backbuffer is compared with a shadow of what has been
+// sent, strip by strip (tftStripRows rows), and each run of changed
+// columns becomes one rectangle: a partial window (CASET/RASET/RAMWR)
+// followed by the scaled RGB565 pixels. Transfers are queued on the
+// SPI DMA and collected without waiting; with both pixel buffers in
+// flight the rest waits for the next frame.
+//
+// Color values go through a 256-entry RGB565 table: UI colors from both
+// palettes map to their RGB look, everything else is treated as a hue in
+// degrees (0 is shared by BLACK and red; it is shown red so critical
+// gauges stay red).
+const int tftStripRows   = 8;
+const int tftSlotCount   = 2;
+const int tftMaxSpanPx   = screenWidth * tftStripRows * tftScale * tftScale;
+const int tftTransPerSpan = 6;
+
+struct TftSlot {
+  spi_transaction_t trans[tftTransPerSpan];
+  uint16_t *pixels;
+  int pending;       // transactions not yet collected
+};
+
+spi_device_handle_t tftDevice = NULL;
+TftSlot tftSlots[tftSlotCount];
+uint16_t tftPalette[256];
+char *tftShadow = NULL;
+int tftNextStrip = 0;
+unsigned long tftBytesSent = 0;
+const int tftOriginX = (tftWidth - screenWidth * tftScale) / 2;
+const int tftOriginY = (tftHeight - screenHeight * tftScale) / 2;
+
+// DC low for commands, high for data; carried in the transaction's user field.
+void IRAM_ATTR tftPreTransfer(spi_transaction_t *t) {
+  digitalWrite(tftDcPin, (int)(intptr_t)t->user);
+}
+
+uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b) {
+  uint16_t c = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+  return (c >> 8) | (c << 8);  // panel takes big-endian pixels
+}
+
+void hueToRgb(int hue, uint8_t &r, uint8_t &g, uint8_t &b) {
+  hue %= 360;
+  uint8_t rise = (hue % 60) * 255 / 60, fall = 255 - rise;
+  switch(hue / 60){
+    case 0:  r = 255;  g = rise; b = 0;    break;
+    case 1:  r = fall; g = 255;  b = 0;    break;
+    case 2:  r = 0;    g = 255;  b = rise; break;
+    case 3:  r = 0;    g = fall; b = 255;  break;
+    case 4:  r = rise; g = 0;    b = 255;  break;
+    default: r = 255;  g = 0;    b = fall; break;
+  }
+}
+
+uint16_t hueToRgb565(int hue) {
+  uint8_t r, g, b;
+  hueToRgb(hue, r, g, b);
+  return rgb565(r, g, b);
+}
+
+void buildTftPalette() {
+  for(int i = 0; i < 256; i++) tftPalette[i] = hueToRgb565(i);
+  tftPalette[dayPalette.background]   = rgb565(0, 0, 96);
+  tftPalette[dayPalette.white]        = rgb565(255, 255, 255);
+  tftPalette[nightPalette.background] = rgb565(0, 0, 24);
+  tftPalette[nightPalette.white]      = rgb565(128, 128, 128);
+}
+
+// Blocking command used only during init.
+void tftCommand(uint8_t cmd, const uint8_t *data = NULL, int len = 0) {
+  spi_transaction_t t;
+  memset(&t, 0, sizeof(t));
+  t.length = 8;
+  t.tx_buffer = &cmd;
+  t.user = (void *)0;
+  spi_device_polling_transmit(tftDevice, &t);
+  if(len){
+    memset(&t, 0, sizeof(t));
+    t.length = len * 8;
+    t.tx_buffer = data;
+    t.user = (void *)1;
+    spi_device_polling_transmit(tftDevice, &t);
+  }
+}
+
+void beginTft() {
+  if(!tftEnabled) return;
+  pinMode(tftDcPin, OUTPUT);
+  pinMode(tftResetPin, OUTPUT);
+  digitalWrite(tftResetPin, LOW);
+  delay(10);
+  digitalWrite(tftResetPin, HIGH);
+  delay(120);
+
+  spi_bus_config_t bus;
+  memset(&bus, 0, sizeof(bus));
+  bus.mosi_io_num = tftMosiPin;
+  bus.miso_io_num = -1;
+  bus.sclk_io_num = tftSclkPin;
+  bus.quadwp_io_num = -1;
+  bus.quadhd_io_num = -1;
+  bus.max_transfer_sz = tftMaxSpanPx * 2;
+
+  spi_device_interface_config_t dev;
+  memset(&dev, 0, sizeof(dev));
+  dev.clock_speed_hz = tftClockHz;
+  dev.mode = 0;
+  dev.spics_io_num = tftCsPin;
+  dev.queue_size = tftSlotCount * tftTransPerSpan;
+  dev.pre_cb = tftPreTransfer;
+
+  if(spi_bus_initialize(VSPI_HOST, &bus, SPI_DMA_CH_AUTO) != ESP_OK ||
+     spi_bus_add_device(VSPI_HOST, &dev, &tftDevice) != ESP_OK){
+    Serial.println("tft: SPI init failed");
+    tftDevice = NULL;
+    return;
+  }
+
+  const uint8_t pixelFormat = 0x55;  // 16 bpp
+  const uint8_t madctl = (tftController == TFT_ILI9341) ? 0x28 : 0x60;  // landscape
+  tftCommand(0x01);  // SWRESET
+  delay(150);
+  tftCommand(0x11);  // SLPOUT
+  delay(120);
+  tftCommand(0x3A, &pixelFormat, 1);
+  tftCommand(0x36, &madctl, 1);
+  if(tftController == TFT_ST7789) tftCommand(0x21);  // INVON
+  tftCommand(0x29);  // DISPON
+
+  for(TftSlot &slot : tftSlots){
+    slot.pixels = (uint16_t *)heap_caps_malloc(tftMaxSpanPx * 2, MALLOC_CAP_DMA);
+    slot.pending = 0;
+  }
+  tftShadow = (char *)arenaAlloc(screenWidth * screenHeight);
+  if(tftShadow) memset(tftShadow, 0xFF, screenWidth * screenHeight);  // differs from anything: first frame sends all
+  buildTftPalette();
+}
+
+void collectTftTransfers() {
+  spi_transaction_t *done;
+  while(spi_device_get_trans_result(tftDevice, &done, 0) == ESP_OK){
+    for(TftSlot &slot : tftSlots){
+      if(done >= slot.trans && done < slot.trans + tftTransPerSpan) slot.pending--;
+    }
+  }
+}
+
+TftSlot *freeTftSlot() {
+  for(TftSlot &slot : tftSlots) if(slot.pending == 0) return &slot;
+  return NULL;
+}
+
+void setTftCommand(spi_transaction_t &t, uint8_t cmd) {
+  memset(&t, 0, sizeof(t));
+  t.flags = SPI_TRANS_USE_TXDATA;
+  t.length = 8;
+  t.tx_data[0] = cmd;
+  t.user = (void *)0;
+}
+
+void setTftWindowData(spi_transaction_t &t, int from, int to) {
+  memset(&t, 0, sizeof(t));
+  t.flags = SPI_TRANS_USE_TXDATA;
+  t.length = 32;
+  t.tx_data[0] = from >> 8;
+  t.tx_data[1] = from;
+  t.tx_data[2] = to >> 8;
+  t.tx_data[3] = to;
+  t.user = (void *)1;
+}
+
+// Queues columns [x0, x1) of the strip starting at row y0.
+void queueTftSpan(TftSlot &slot, int x0, int x1, int y0) {
+  int w = (x1 - x0) * tftScale, h = tftStripRows * tftScale;
+  uint16_t *out = slot.pixels;
+  for(int row = 0; row < tftStripRows; row++){
+    const char *src = frameRow(y0 + row);
+    uint16_t *line = out;
+    for(int x = x0; x < x1; x++){
+      uint16_t c = tftPalette[(uint8_t)src[x]];
+      for(int k = 0; k < tftScale; k++) *out++ = c;
+    }
+    for(int k = 1; k < tftScale; k++, out += w) memcpy(out, line, w * 2);
+    memcpy(tftShadow + (y0 + row) * screenWidth + x0, src + x0, x1 - x0);
+  }
+
+  int px = tftOriginX + x0 * tftScale, py = tftOriginY + y0 * tftScale;
+  spi_transaction_t *t = slot.trans;
+  setTftCommand(t[0], 0x2A);  // CASET
+  setTftWindowData(t[1], px, px + w - 1);
+  setTftCommand(t[2], 0x2B);  // RASET
+  setTftWindowData(t[3], py, py + h - 1);
+  setTftCommand(t[4], 0x2C);  // RAMWR
+  memset(&t[5], 0, sizeof(t[5]));
+  t[5].length = w * h * 16;
+  t[5].tx_buffer = slot.pixels;
+  t[5].user = (void *)1;
+
+  slot.pending = tftTransPerSpan;
+  for(int i = 0; i < tftTransPerSpan; i++) spi_device_queue_trans(tftDevice, &t[i], 0);
+  tftBytesSent += w * h * 2 + 3 * 1 + 2 * 4;
+}
+
+bool stripColumnDirty(int y0, int x) {
+  for(int row = 0; row < tftStripRows; row++){
+    if(frameRow(y0 + row)[x] != tftShadow[(y0 + row) * screenWidth + x]) return true;
+  }
+  return false;
+}
+
+void tftFrame() {
+  if(!tftDevice || !tftShadow) return;
+  unsigned long start = micros();
+  collectTftTransfers();
+
+  const int strips = screenHeight / tftStripRows;
+  for(int scanned = 0; scanned < strips && micros() - start < tftSliceUs; scanned++){
+    int y0 = tftNextStrip * tftStripRows;
+    for(int x = 0; x < screenWidth; ){
+      if(!stripColumnDirty(y0, x)){ x++; continue; }
+      int x1 = x + 1;
+      while(x1 < screenWidth && stripColumnDirty(y0, x1)) x1++;
+      TftSlot *slot = freeTftSlot();
+      if(!slot) return;  // both buffers in flight: resume this strip next frame
+      queueTftSpan(*slot, x, x1, y0);
+      x = x1;
+    }
+    tftNextStrip = (tftNextStrip + 1) % strips;
+  }
+}
+
+#if ATTR_VIDEO
+// -------------------------------------------------------------------
+// Attribute video palette
+// The four UI colors of both palettes (with the TFT's RGB looks) and
+// twelve hues attrHueStep apart; any other color value shows as the
+// nearest of those hues. Like on the TFT, 0 is taken as red.
+const int attrUiColors = 4;
+const int attrHueCount = 12;
+const int attrHueStep  = 22;
+
+void setAttrUiColor(uint8_t index, uint16_t color, uint8_t r, uint8_t g, uint8_t b) {
+  graphics.setPaletteEntry(index, color, r, g, b);
+  graphics.colorIndex[color] = index;
+}
+
+void buildAttrPalette() {
+  for(int i = 0; i < attrHueCount; i++){
+    uint8_t r, g, b;
+    hueToRgb(i * attrHueStep, r, g, b);
+    graphics.setPaletteEntry(attrUiColors + i, i * attrHueStep, r, g, b);
+  }
+  for(int color = 0; color < 256; color++){
+    int hue = min((color + attrHueStep / 2) / attrHueStep, attrHueCount - 1);
+    graphics.colorIndex[color] = attrUiColors + hue;
+  }
+  setAttrUiColor(0, dayPalette.background,   0, 0, 96);
+  setAttrUiColor(1, dayPalette.white,        255, 255, 255);
+  setAttrUiColor(2, nightPalette.background, 0, 0, 24);
+  setAttrUiColor(3, nightPalette.white,      128, 128, 128);
+}
+#endif
+
+// -------------------------------------------------------------------
+// Test patterns (console "test")
+enum TestPattern : uint8_t { TEST_OFF, TEST_BARS, TEST_GRID };
+TestPattern testPattern = TEST_OFF;
+
+// Drawn once; screenBg doubles as the "already on screen" flag.
+void drawTestPattern() {
+  if(screenBg == BLACK) return;
+  invalidateScreen();
+  graphics.fillScreen(BLACK);
+  if(testPattern == TEST_BARS){
+    const int bars = 8;
+    for(int i = 0; i < bars; i++){
+      graphics.fillRect(i * screenWidth / bars, 0, screenWidth / bars, screenHeight, i * 120 / (bars - 1));
+    }
+  } else {
+    for(int x = 0; x < screenWidth; x += 8) graphics.fillRect(x, 0, 1, screenHeight, WHITE);
+    for(int y = 0; y < screenHeight; y += 8) graphics.fillRect(0, y, screenWidth, 1, WHITE);
+    graphics.drawRect(0, 0, screenWidth, screenHeight, WHITE);
+  }
+  screenBg = BLACK;
+}
+
+// -------------------------------------------------------------------
+// Serial console
+// Line-oriented commands on Serial. Bytes are taken from the UART
+// driver's RX ring a few at a time and assembled into a fixed line
+// buffer, so the console never blocks the loop. Commands come from a
+// const table and run on the in-place tokenised line; nothing is
+// allocated. Replies are kept short so printf stays on its stack buffer.
+// Gauge ranges are copied from the calibration; call after changing it.
+void applyCalibration() {
+  gauges[CH_COOLANT].valueMin = coolantCMin;
+  gauges[CH_COOLANT].valueMax = coolantCMax;
+  gauges[CH_FUEL].valueMin    = fuelLitersMin;
+  gauges[CH_FUEL].valueMax    = fuelLitersMax;
+  screenBg = notDrawn;  // bar scales moved: repaint
+}
+
+struct CalibrationEntry {
+  const char *name;
+  int *value;
+  int minValue, maxValue;  // accepted range
+};
+
+const CalibrationEntry calibrationTable[] = {
+  { "coolantADCMin",      &coolantADCMin,      0, 4095 },
+  { "coolantADCMax",      &coolantADCMax,      0, 4095 },
+  { "coolantCMin",        &coolantCMin,      -40, 150 },
+  { "coolantCMax",        &coolantCMax,      -40, 150 },
+  { "coolantCriticalC",   &coolantCriticalC, -40, 150 },
+  { "coolantNormalMin",   &coolantNormalMin, -40, 150 },
+  { "fuelADCMin",         &fuelADCMin,         0, 4095 },
+  { "fuelADCMax",         &fuelADCMax,         0, 4095 },
+  { "fuelLitersMin",      &fuelLitersMin,      0, 250 },
+  { "fuelLitersMax",      &fuelLitersMax,      0, 250 },
+  { "fuelCriticalLiters", &fuelCriticalLiters, 0, 250 },
+};
+
+// Every value in range and every scale the conversions map() over
+// running forwards; an empty scale would divide by zero.
+bool calibrationValid() {
+  for(const CalibrationEntry &entry : calibrationTable){
+    if(*entry.value < entry.minValue || *entry.value > entry.maxValue) return false;
+  }
+  return coolantADCMin < coolantADCMax && coolantCMin < coolantCMax
+      && fuelADCMin < fuelADCMax && fuelLitersMin < fuelLitersMax;
+}
+
+struct ConsoleCommand {
+  const char *name;
+  const char *usage;
+  void (*run)(int argc, char **argv);
+};
+
+void cmdHelp(int argc, char **argv);
+
+void cmdAdc(int argc, char **argv) {
+  Serial.printf("coolant raw %d filt %d = %dC\n", sensors.coolantRaw, sensors.coolantADC, sensors.coolantC);
+  Serial.printf("fuel    raw %d filt %d = %dL\n", sensors.fuelRaw, sensors.fuelADC, sensors.fuelLiters);
+  Serial.printf("ambient filt %d  oil %s\n", sensors.ambientADC, sensors.oilCritical ? "LOW" : "OK");
+}
+
+void cmdCal(int argc, char **argv) {
+  for(const CalibrationEntry &entry : calibrationTable){
+    if(argc >= 2 && strcmp(argv[1], entry.name) != 0) continue;
+    if(argc >= 3){
+      char *end;
+      long value = strtol(argv[2], &end, 10);
+      if(end == argv[2] || *end){
+        Serial.printf("not a number: %s\n", argv[2]);
+        return;
+      }
+      if(value < entry.minValue || value > entry.maxValue){
+        Serial.printf("%s range %d..%d\n", entry.name, entry.minValue, entry.maxValue);
+        return;
+      }
+      int old = *entry.value;
+      *entry.value = value;
+      if(!calibrationValid()){
+        *entry.value = old;
+        Serial.println("rejected: each min must stay below its max");
+        return;
+      }
+      applyCalibration();
+    }
+    Serial.printf("%s = %d\n", entry.name, *entry.value);
+    if(argc >= 2) return;
+  }
+  if(argc >= 2) Serial.printf("unknown calibration %s\n", argv[1]);
+}
+
+// The built-in layout as straight-line calls with its types and
+// channels fixed, the way the gauges were drawn before layouts.
+void drawDefaultLayoutDirect(Widget *w, bool flash) {
+  uint16_t oilText     = (sensors.oilCritical && flash)     ? BLACK : WHITE;
+  uint16_t coolantText = (sensors.coolantCritical && flash) ? BLACK : WHITE;
+  uint16_t fuelText    = (sensors.fuelCritical && flash)    ? BLACK : WHITE;
+  drawIconWidget(w[0], channelHue(CH_OIL));
+  drawAlarmText(w[1], sensors.oilCritical ? oilText : notDrawn);
+  drawIconWidget(w[2], channelHue(CH_COOLANT));
+  drawBarWidget(w[3], channelHue(CH_COOLANT));
+  drawBigValue(w[4], barShownValue(gauges[CH_COOLANT]), coolantText);
+  drawIconWidget(w[5], channelHue(CH_FUEL));
+  drawBarWidget(w[6], channelHue(CH_FUEL));
+  drawBigValue(w[7], barShownValue(gauges[CH_FUEL]), fuelText);
+}
+
+// Average of one pass over the widgets, either repainting everything
+// (state invalidated first) or with nothing changed, where all that is
+// left is dispatch and the retained-state checks.
+unsigned long timeLayoutPass(bool direct, bool full) {
+  const int passes = 32;
+  unsigned long total = 0;
+  for(int i = 0; i < passes; i++){
+    if(full) invalidateScreen();
+    unsigned long start = micros();
+    if(direct) drawDefaultLayoutDirect(widgets, false);
+    else for(int w = 0; w < widgetCount; w++) drawWidget(widgets[w], false);
+    total += micros() - start;
+  }
+  return total / passes;
+}
+
+// "layout bench" times the built-in layout through the interpreter and
+// as direct calls, then puts the loaded layout back and repaints.
+void cmdLayout(int argc, char **argv) {
+  if(argc < 2 || strcmp(argv[1], "bench") != 0){
+    Serial.printf("layout %d widgets, load %lu us\n", widgetCount, layoutLoadUs);
+    return;
+  }
+  static Widget saved[maxWidgets];
+  int savedCount = widgetCount;
+  memcpy(saved, widgets, sizeof(saved));
+  uint8_t blob[sizeof(defaultLayout)];
+  memcpy_P(blob, defaultLayout, sizeof(blob));
+  parseLayout(blob, sizeof(blob));
+
+  unsigned long layoutFull   = timeLayoutPass(false, true);
+  unsigned long directFull   = timeLayoutPass(true, true);
+  unsigned long layoutSteady = timeLayoutPass(false, false);
+  unsigned long directSteady = timeLayoutPass(true, false);
+
+  memcpy(widgets, saved, sizeof(saved));
+  widgetCount = savedCount;
+  invalidateScreen();
+  Serial.printf("full:   layout %lu us  direct %lu us\n", layoutFull, directFull);
+  Serial.printf("steady: layout %lu us  direct %lu us\n", layoutSteady, directSteady);
+}
+
+void cmdPerf(int argc, char **argv) {
+  if(argc >= 2 && strcmp(argv[1], "reset") == 0){
+    frameMaxUs = 0;
+#if ATTR_VIDEO
+    graphics.lineCyclesMax = 0;
+    graphics.prefetchUnderruns = 0;
+#endif
+  }
+  Serial.printf("frame %lu us  max %lu us\n", frameTimeUs, frameMaxUs);
+  Serial.printf("telemetry seq %u  dropped %u\n", telemetrySeq, telemetryDropped);
+  Serial.printf("layout load %lu us  page cache %u B\n", layoutLoadUs, (unsigned)pageCacheBytes());
+  Serial.printf("tft bytes sent %lu\n", tftBytesSent);
+#if ATTR_VIDEO
+  Serial.printf("scanout line max %u cycles (64 us = %u)\n", (unsigned)graphics.lineCyclesMax,
+                (unsigned)(64 * getCpuFrequencyMhz()));
+#if PSRAM_FRAME
+  Serial.printf("prefetch underruns %u (ring %d rows)\n", (unsigned)graphics.prefetchUnderruns, attrPrefetchRows);
+#endif
+#endif
+}
+
+void cmdHist(int argc, char **argv) {
+  if(argc >= 2 && strcmp(argv[1], "reset") == 0){
+    resetFrameHistogram();
+    return;
+  }
+  for(int i = 0; i < histBuckets; i++){
+    if(frameHist[i]) Serial.printf("%6lu us%s %lu\n", 1UL << i, i == histBuckets - 1 ? "+" : " ",
+                                   (unsigned long)frameHist[i]);
+  }
+  Serial.printf("overruns %lu (budget %lu us)\n", frameOverruns, frameBudgetUs);
+  for(int n = 0; n < overrunTraceCount; n++){
+    const FrameTrace &trace = overrunTraces[(overrunNext + n) % overrunTraceCount];  // oldest first
+    if(!trace.totalUs) continue;
+    // Kept under Print::printf's 64-byte stack buffer so it doesn't allocate.
+    Serial.printf("@%lu ms %u us, late %u", trace.atMs, trace.totalUs, trace.lateUs);
+    Serial.printf(", sensors %u, text %u%s |", trace.sensorMaxUs, trace.textBuilds,
+                  trace.flashBusy ? ", flash busy" : "");
+    for(int phase = 0; phase < PHASE_COUNT; phase++) Serial.printf(" %s %u", phaseNames[phase], trace.phaseUs[phase]);
+    Serial.println();
+  }
+}
+
+// One alarm text through print(), an uncached run and a cached run,
+// drawn in the top-left corner; the screen is repainted afterwards.
+void cmdFont(int argc, char **argv) {
+  const int draws = 16;
+  const char *text = alarmTexts[0];
+  unsigned long start = micros();
+  for(int i = 0; i < draws; i++){
+    graphics.setCursor(0, 0);
+    graphics.setHue(WHITE);
+    graphics.print(text);
+  }
+  unsigned long printUs = (micros() - start) / draws;
+  start = micros();
+  for(int i = 0; i < draws; i++) drawText(0, 0, text, WHITE);
+  unsigned long runUs = (micros() - start) / draws;
+  drawStaticText(0, 0, text, WHITE);  // builds the run if it is not cached yet
+  start = micros();
+  for(int i = 0; i < draws; i++) drawStaticText(0, 0, text, WHITE);
+  unsigned long cachedUs = (micros() - start) / draws;
+  invalidateScreen();
+  // Split so no call outgrows Print::printf's 64-byte stack buffer.
+  Serial.printf("\"%s\" (%d px)\n", text, textWidth(text));
+  Serial.printf("print %lu us  proportional %lu us", printUs, runUs);
+  Serial.printf("  cached %lu us\n", cachedUs);
+  Serial.printf("text runs %d/%d, pool %u/%u B\n", textRunCount, textRunSlots,
+                (unsigned)textRunPoolUsed, (unsigned)textRunPoolBytes);
+}
+
+void cmdMem(int argc, char **argv) {
+  sampleMemory();
+  Serial.printf("heap free %u B  min %u B  largest block %u B\n", (unsigned)memStats.heapFree,
+                (unsigned)memStats.heapMinFree, (unsigned)memStats.heapLargestBlock);
+  Serial.printf("arena %u/%u B\n", memStats.arenaUsed, memStats.arenaBytes);
+  Serial.printf("stack headroom loop %u B  watchdog %u B  checkpoint %u B\n",
+                memStats.stackLoop, memStats.stackWatchdog, memStats.stackCheckpoint);
+}
+
+void cmdTest(int argc, char **argv) {
+  TestPattern next = TEST_OFF;
+  if(argc >= 2 && strcmp(argv[1], "bars") == 0) next = TEST_BARS;
+  else if(argc >= 2 && strcmp(argv[1], "grid") == 0) next = TEST_GRID;
+  testPattern = next;
+  screenBg = notDrawn;  // repaint with the pattern or the page
+}
+
+void cmdForce(int argc, char **argv) {
+  if(argc < 3){
+    Serial.println("usage: force oil|coolant|fuel on|off|auto");
+    return;
+  }
+  ForceState state = strcmp(argv[2], "on") == 0  ? FORCE_ON
+                   : strcmp(argv[2], "off") == 0 ? FORCE_OFF : FORCE_AUTO;
+  if(strcmp(argv[1], "oil") == 0)          forceOil = state;
+  else if(strcmp(argv[1], "coolant") == 0) forceCoolant = state;
+  else if(strcmp(argv[1], "fuel") == 0)    forceFuel = state;
+  else Serial.printf("unknown alarm %s\n", argv[1]);
+}
+
+void requestCheckpoint();
+
+void cmdTrip(int argc, char **argv) {
+  if(argc >= 2 && strcmp(argv[1], "reset") == 0){
+    resetTrip();
+    requestCheckpoint();  // so the old trip does not come back after power loss
+  }
+  Serial.printf("trip %lu min  max %d C\n", (millis() - trip.startMs) / 60000, trip.maxCoolantC);
+  Serial.printf("fuel start %d L  min %d L  used %d L\n", trip.startFuelLiters,
+                trip.minFuelLiters, max(trip.startFuelLiters - sensors.fuelLiters, 0));
+}
+
+void cmdStall(int argc, char **argv) {
+  for(uint8_t sub = 0; argc >= 2 && sub < SUB_COUNT; sub++){
+    if(strcasecmp(argv[1], subsystemNames[sub]) == 0){
+      injectedStall = sub;
+      return;
+    }
+  }
+  Serial.println("usage: stall acq|glow|render|logger");
+}
+
+const ConsoleCommand consoleCommands[] = {
+  { "help",  "",                          cmdHelp },
+  { "adc",   "",                          cmdAdc },
+  { "cal",   "[name [value]]",            cmdCal },
+  { "perf",  "[reset]",                   cmdPerf },
+  { "layout", "[bench]",                  cmdLayout },
+  { "hist",  "[reset]",                   cmdHist },
+  { "mem",   "",                          cmdMem },
+  { "font",  "",                          cmdFont },
+  { "test",  "bars|grid|off",             cmdTest },
+  { "force", "oil|coolant|fuel on|off|auto", cmdForce },
+  { "trip",  "[reset]",                   cmdTrip },
+  { "stall", "acq|glow|render|logger",    cmdStall },
+};
+
+void cmdHelp(int argc, char **argv) {
+  for(const ConsoleCommand &cmd : consoleCommands) Serial.printf("%s %s\n", cmd.name, cmd.usage);
+}
+
+// Commands run inline on the loop, so no subsystem beats while one runs
+// (the benches take far longer than the acquisition timeout); the
+// watchdog holds its checks off for up to consoleCommandMaxMs.
+volatile bool consoleCommandActive = false;
+volatile unsigned long consoleCommandStartMs = 0;
+
+void runConsoleLine(char *line) {
+  char *argv[consoleMaxArgs];
+  int argc = 0;
+  char *save = NULL;
+  for(char *tok = strtok_r(line, " \t", &save); tok && argc < consoleMaxArgs; tok = strtok_r(NULL, " \t", &save)){
+    argv[argc++] = tok;
+  }
+  if(argc == 0) return;
+
+  for(const ConsoleCommand &cmd : consoleCommands){
+    if(strcmp(argv[0], cmd.name) == 0){
+      consoleCommandStartMs = millis();
+      consoleCommandActive = true;
+      cmd.run(argc, argv);
+      consoleCommandActive = false;
+      return;
+    }
+  }
+  Serial.printf("unknown command %s\n", argv[0]);
+}
+
+void pollConsole() {
+  static char line[consoleLineMax + 1];
+  static int length = 0;
+  static bool overflow = false;
+
+  for(int budget = consoleBytesPerPass; budget > 0 && Serial.available() > 0; budget--){
+    char c = Serial.read();
+    if(c == '\r') continue;
+    if(c == '\n'){
+      line[length] = 0;
+      if(overflow) Serial.println("line too long");
+      else runConsoleLine(line);
+      length = 0;
+      overflow = false;
+    } else if(length < consoleLineMax){
+      line[length++] = c;
+    } else {
+      overflow = true;
+    }
+  }
+}
+
+// -------------------------------------------------------------------
+// Checkpoints
+// State that must survive an ignition cut is written to the "ckpt"
+// partition, which holds two one-sector slots used ping-pong. Each
+// record carries a generation counter and a CRC; at boot the valid slot
+// with the highest generation wins. The next write always goes to the
+// other slot, which is erased ahead of time, so a write is a single
+// short program operation and a power cut mid-write leaves the previous
+// slot intact. The old slot is erased only after the new one is written.
+//
+// Writes happen in a low-priority task woken by requestCheckpoint():
+// from the loop when the state has moved past a change threshold (at
+// most every checkpointMinIntervalMs), and from the ignition-sense
+// interrupt when power is about to go. The task runs on the other core,
+// so it never reads sensors, trip or calibration itself: the loop
+// publishes a ready record every frame and the task copies it under
+// checkpointMux.
+//
+// The power-loss trigger is ignition sense rather than the chip's
+// brownout detector. The brownout interrupt only fires once the supply
+// is down at 2.4-2.8 V, below what the SPI flash is specified to program
+// at, and the core resets from its handler; the ignition line drops
+// while the hold-up capacitor still keeps the 3.3 V rail in spec.
+const uint32_t checkpointMagic = 0x434B5031;  // "CKP1"
+const uint16_t checkpointVersion = 2;         // bump when the layout changes
+const int calibrationCount = sizeof(calibrationTable) / sizeof(calibrationTable[0]);
+const size_t checkpointSlotBytes = 4096;
+
+struct __attribute__((packed)) Checkpoint {
+  uint32_t magic;
+  uint16_t version;            // records of another layout are ignored
+  uint32_t generation;
+  int16_t  coolantC;
+  int16_t  fuelLiters;
+  uint32_t tripSeconds;
+  int16_t  tripStartFuelLiters;
+  int16_t  tripMaxCoolantC;
+  int16_t  tripMinFuelLiters;
+  uint32_t engineSeconds;      // running-time meter; there is no distance input
+  int32_t  calibration[calibrationCount];  // same type as the live values
+  uint16_t crc;                // over everything before it
+};
+
+const esp_partition_t *checkpointPartition = NULL;
+portMUX_TYPE checkpointMux = portMUX_INITIALIZER_UNLOCKED;
+Checkpoint checkpointSaved;       // last record written (guarded by checkpointMux)
+Checkpoint checkpointLive;        // latest state from the loop (guarded by checkpointMux)
+int checkpointSlot = 0;           // slot the next record goes to
+uint32_t engineSecondsBase = 0;   // restored meter reading at boot
+unsigned long checkpointRequestedAt = 0;
+uint32_t checkpointWrites = 0;
+uint32_t checkpointFailures = 0;  // writes that did not program
+volatile unsigned long ignitionHandledMs = 0;
+volatile bool ignitionHandled = false;
+
+uint32_t engineSeconds() {
+  return engineSecondsBase + millis() / 1000;
+}
+
+void captureCheckpoint(Checkpoint &cp) {
+  memset(&cp, 0, sizeof(cp));
+  cp.magic               = checkpointMagic;
+  cp.version             = checkpointVersion;
+  cp.coolantC            = sensors.coolantC;
+  cp.fuelLiters          = sensors.fuelLiters;
+  cp.tripSeconds         = (millis() - trip.startMs) / 1000;
+  cp.tripStartFuelLiters = trip.startFuelLiters;
+  cp.tripMaxCoolantC     = trip.maxCoolantC;
+  cp.tripMinFuelLiters   = trip.minFuelLiters;
+  cp.engineSeconds       = engineSeconds();
+  for(int i = 0; i < calibrationCount; i++) cp.calibration[i] = *calibrationTable[i].value;
+}
+
+bool checkpointValid(const Checkpoint &cp) {
+  return cp.magic == checkpointMagic && cp.version == checkpointVersion
+      && cp.crc == crc16((const uint8_t *)&cp, offsetof(Checkpoint, crc));
+}
+
+// Loop side: the only writer of sensors, trip and calibration.
+void publishCheckpoint() {
+  Checkpoint cp;
+  captureCheckpoint(cp);
+  portENTER_CRITICAL(&checkpointMux);
+  checkpointLive = cp;
+  portEXIT_CRITICAL(&checkpointMux);
+}
+
+// An erase or write turns the flash cache off, which stalls both cores
+// until it is done; the watchdog uses the count to forgive that time.
+void beginFlashOp() {
+  flashOpStartMs = millis();
+  flashOps++;
+  flashWriteActive = true;
+}
+
+void eraseCheckpointSlot(int slot) {
+  beginFlashOp();
+  esp_partition_erase_range(checkpointPartition, slot * checkpointSlotBytes, checkpointSlotBytes);
+  flashWriteActive = false;
+}
+
+// Writes the published record to the target slot. A failed program can
+// leave the slot half written, and programming over that would AND the
+// retry into it, so the slot is erased again before returning.
+bool writeCheckpoint() {
+  Checkpoint cp;
+  portENTER_CRITICAL(&checkpointMux);
+  cp = checkpointLive;
+  cp.generation = checkpointSaved.generation + 1;
+  portEXIT_CRITICAL(&checkpointMux);
+  cp.crc = crc16((const uint8_t *)&cp, offsetof(Checkpoint, crc));
+
+  beginFlashOp();
+  esp_err_t written = esp_partition_write(checkpointPartition, checkpointSlot * checkpointSlotBytes, &cp, sizeof(cp));
+  flashWriteActive = false;
+  if(written != ESP_OK){
+    checkpointFailures++;
+    eraseCheckpointSlot(checkpointSlot);
+    return false;
+  }
+
+  portENTER_CRITICAL(&checkpointMux);
+  checkpointSaved = cp;
+  checkpointWrites++;
+  portEXIT_CRITICAL(&checkpointMux);
+
+  // The slot just superseded becomes the next target; erase it now,
+  // while there is time, so the next write is program-only.
+  checkpointSlot ^= 1;
+  eraseCheckpointSlot(checkpointSlot);
+  return true;
+}
+
+void checkpointTask(void *) {
+  // Make sure the first target slot is blank before anything is written.
+  eraseCheckpointSlot(checkpointSlot);
+  for(;;){
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    for(int attempt = 0; attempt < checkpointWriteAttempts && !writeCheckpoint(); attempt++) {}
+  }
+}
+
+// Loop side only: the record is published first so the write has the
+// state the caller just changed.
+void requestCheckpoint() {
+  if(!checkpointTaskHandle) return;
+  publishCheckpoint();
+  xTaskNotifyGive(checkpointTaskHandle);
+}
+
+// Writes the record the loop published last (at most a frame old). An
+// edge with the line already back high is a glitch, and edges within
+// ignitionHoldoffMs of a handled one are bounce: neither costs flash.
+void IRAM_ATTR onIgnitionOff() {
+  unsigned long now = millis();
+  if(digitalRead(ignitionPin) != LOW) return;
+  if(ignitionHandled && now - ignitionHandledMs < ignitionHoldoffMs) return;
+  ignitionHandled = true;
+  ignitionHandledMs = now;
+  BaseType_t woken = pdFALSE;
+  if(checkpointTaskHandle) vTaskNotifyGiveFromISR(checkpointTaskHandle, &woken);
+  if(woken) portYIELD_FROM_ISR();
+}
+
+// A record whose calibration fails the console's checks keeps the
+// compiled-in values; the trip and meter are still restored.
+void restoreCheckpoint(const Checkpoint &cp) {
+  int32_t kept[calibrationCount];
+  for(int i = 0; i < calibrationCount; i++){
+    kept[i] = *calibrationTable[i].value;
+    *calibrationTable[i].value = cp.calibration[i];
+  }
+  if(!calibrationValid()){
+    for(int i = 0; i < calibrationCount; i++) *calibrationTable[i].value = kept[i];
+  }
+  applyCalibration();
+  trip.startMs         = millis() - cp.tripSeconds * 1000UL;
+  trip.startFuelLiters = cp.tripStartFuelLiters;
+  trip.maxCoolantC     = cp.tripMaxCoolantC;
+  trip.minFuelLiters   = cp.tripMinFuelLiters;
+  engineSecondsBase    = cp.engineSeconds;
+}
+
+// Call after the sensors and trip are initialised: a valid checkpoint
+// overrides the fresh trip and the compiled-in calibration.
+void beginCheckpoints() {
+  checkpointPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "ckpt");
+  if(!checkpointPartition || checkpointPartition->size < 2 * checkpointSlotBytes){
+    Serial.println("checkpoint: no ckpt partition");
+    return;
+  }
+
+  Checkpoint slots[2];
+  int newest = -1;
+  for(int i = 0; i < 2; i++){
+    esp_partition_read(checkpointPartition, i * checkpointSlotBytes, &slots[i], sizeof(Checkpoint));
+    if(checkpointValid(slots[i]) && (newest < 0 || slots[i].generation > slots[newest].generation)) newest = i;
+  }
+  if(newest >= 0){
+    restoreCheckpoint(slots[newest]);
+    checkpointSaved = slots[newest];
+    checkpointSlot = newest ^ 1;
+    Serial.printf("checkpoint: restored generation %u from slot %d\n", slots[newest].generation, newest);
+  } else {
+    captureCheckpoint(checkpointSaved);
+    checkpointSaved.generation = 0;
+  }
+  publishCheckpoint();
+
+  xTaskCreatePinnedToCore(checkpointTask, "checkpoint", 3072, NULL, 1, &checkpointTaskHandle, 0);
+  if(ignitionPin >= 0){
+    pinMode(ignitionPin, INPUT);
+    attachInterrupt(digitalPinToInterrupt(ignitionPin), onIgnitionOff, FALLING);
+  }
+}
+
+// Every frame: publishes the record, then asks for a write if it has
+// moved far enough from the last one written.
+void updateCheckpoint() {
+  if(!checkpointTaskHandle) return;
+
+  Checkpoint now, saved;
+  captureCheckpoint(now);
+  portENTER_CRITICAL(&checkpointMux);
+  checkpointLive = now;
+  saved = checkpointSaved;
+  portEXIT_CRITICAL(&checkpointMux);
+  if(millis() - checkpointRequestedAt < checkpointMinIntervalMs) return;
+
+  bool due = now.tripMaxCoolantC != saved.tripMaxCoolantC
+          || now.tripMinFuelLiters != saved.tripMinFuelLiters
+          || abs(now.fuelLiters - saved.fuelLiters) >= checkpointFuelDelta
+          || memcmp(now.calibration, saved.calibration, sizeof(now.calibration)) != 0
+          || now.engineSeconds - saved.engineSeconds >= checkpointMaxAgeS;
+  if(due){
+    checkpointRequestedAt = millis();
+    requestCheckpoint();
+  }
+}
+
+// -------------------------------------------------------------------
+// Watchdog
+// A task on core 0 checks the heartbeats every watchdogPeriodMs. When
+// one is older than its timeout it switches the glow plug off first,
+// stores which subsystem stalled and which probe was active in RTC
+// memory, and restarts. The loop task is also registered with the
+// hardware task watchdog as a backstop for a wedged core.
+// "stall <subsystem>" on the console hangs that subsystem on purpose.
+//
+// A checkpoint erase stalls both cores for tens to hundreds of ms, the
+// watchdog included, so when it next runs every heartbeat looks stale.
+// Beats missed while a flash operation ran, or since one the watchdog
+// did not see, are not counted; a flash operation that has not finished
+// after flashOpMaxMs no longer holds the checks off. A console command
+// running on the loop is waited out the same way, up to
+// consoleCommandMaxMs.
+
+void stallReboot(uint8_t sub, unsigned long stalledMs) {
+  digitalWrite(glowPin, LOW);
+  stallRecord.subsystem = sub;
+  stallRecord.probe     = activeProbe;
+  stallRecord.uptimeMs  = millis();
+  stallRecord.stalledMs = stalledMs;
+  stallRecord.magic     = stallMagic;
+  esp_restart();
+}
+
+uint32_t watchdogFlashOps = 0;
+unsigned long watchdogHeldMs = 0;  // heartbeats older than this count from here
+
+void checkHeartbeats(unsigned long now) {
+  uint32_t ops = flashOps;
+  bool flashBusy = flashWriteActive && now - flashOpStartMs < flashOpMaxMs;
+  bool commandBusy = consoleCommandActive && now - consoleCommandStartMs < consoleCommandMaxMs;
+  if(ops != watchdogFlashOps || flashBusy || commandBusy){
+    watchdogFlashOps = ops;
+    watchdogHeldMs = now;
+  }
+  for(uint8_t sub = 0; sub < SUB_COUNT; sub++){
+    unsigned long age = min(now - heartbeatMs[sub], now - watchdogHeldMs);
+    if(age > heartbeatTimeoutMs[sub]) stallReboot(sub, age);
+  }
+}
+
+void watchdogTask(void *) {
+  for(;;){
+    vTaskDelay(pdMS_TO_TICKS(watchdogPeriodMs));
+    checkHeartbeats(millis());
+  }
+}
+
+// Hangs in place when the console asked this subsystem to stall.
+void stallPoint(Subsystem sub) {
+  if(injectedStall == sub) for(;;){}
+}
+
+void reportLastStall() {
+  lastStall = stallRecord;
+  stallRecord.magic = 0;
+  if(lastStall.magic != stallMagic || lastStall.subsystem >= SUB_COUNT || lastStall.probe >= PROBE_COUNT){
+    lastStall.magic = 0;
+    return;
+  }
+  Serial.printf("last reset: %s stalled %lu ms in %s at %lu ms uptime\n",
+                subsystemNames[lastStall.subsystem], (unsigned long)lastStall.stalledMs,
+                probeNames[lastStall.probe], (unsigned long)lastStall.uptimeMs);
+}
+
+void beginWatchdog() {
+  for(uint8_t sub = 0; sub < SUB_COUNT; sub++) beat((Subsystem)sub);
+  xTaskCreatePinnedToCore(watchdogTask, "watchdog", 2048, NULL, configMAX_PRIORITIES - 1, &watchdogTaskHandle, 0);
+  enableLoopWDT();
+}
+
+#if DUAL_VIDEO
+// -------------------------------------------------------------------
+// Second screen
+// The second composite output (GPIO 26) shows trip and diagnostic
+// figures, e.g. for a passenger display. Like the main screen it is
+// retained: the background and labels are drawn once, and a refresh
+// (every secondScreenPeriodMs, so the figures stay readable) only
+// repaints the values that changed, as the frame is being scanned out.
+const unsigned long secondScreenPeriodMs = 500;
+const char *const secondLabels[secondRowCount] = {
+  "TRIP TIME", "MAX TEMP", "MIN FUEL", "FUEL USED", "ENGINE", "FRAME", "HEAP MIN",
+};
+
+void drawSecondScreen() {
+  static unsigned long lastDrawMs = 0;
+  if(secondScreenBg != notDrawn && millis() - lastDrawMs < secondScreenPeriodMs) return;
+  lastDrawMs = millis();
+
+  graphics.select(1);
+  if(secondScreenBg == notDrawn){
+    graphics.fillScreen(DARKBLUE);
+    graphics.setHue(WHITE);
+    for(int i = 0; i < secondRowCount; i++){
+      graphics.setCursor(0, secondValues[i].y);
+      graphics.print(secondLabels[i]);
+    }
+    secondScreenBg = DARKBLUE;
+  }
+  const int values[secondRowCount] = {
+    (int)((millis() - trip.startMs) / 60000),
+    trip.maxCoolantC,
+    trip.minFuelLiters,
+    max(trip.startFuelLiters - sensors.fuelLiters, 0),
+    (int)(engineSeconds() / 3600),
+    (int)frameTimeUs,
+    (int)(memStats.heapMinFree / 1024),
+  };
+  for(int i = 0; i < secondRowCount; i++){
+    ValueLabel &label = secondValues[i];
+    drawValueAt(label.x, label.y, label.unit, values[i], WHITE, label.drawnValue, label.drawnColor, secondScreenBg);
+  }
+  graphics.select(0);
+}
+#endif
+
+// -------------------------------------------------------------------
+// Setup & loop
+void setup() {
+  pinMode(oilPin, INPUT_PULLUP);
+  pinMode(coolantPin, INPUT);
+  pinMode(fuelPin, INPUT);
+  pinMode(ambientPin, INPUT);
+  pinMode(glowButtonPin, INPUT_PULLUP);
+  pinMode(glowPin, OUTPUT);
+  digitalWrite(glowPin, LOW);
+
+  Serial.begin(115200);
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  reportLastStall();
+  beginTelemetry();
+  beginMirror();
+  beginTft();
+
+#if ATTR_VIDEO
+  buildAttrPalette();
+  frameRowsChanged();
+#endif
+  graphics.begin();
+  graphics.setFont(0);
+#if ATTR_VIDEO
+  Serial.printf("attribute video: %d screen(s) x %u B frame, line buffer %u B, DMA 2 x %u B\n",
+                attrScreens, (unsigned)graphics.frameBytes(), (unsigned)graphics.lineBytes(),
+                (unsigned)graphics.lineBytes());
+#if PSRAM_FRAME
+  Serial.printf("frames in PSRAM, row ring %u B per screen\n", (unsigned)graphics.ringBytes());
+#endif
+#endif
+  loadLayout();
+  fitMainPageToLayout();
+  allocatePageCaches();
+  buildNightRemaps();
+  beginAlarmSound();
+
+  // Seed the filters so the first frame doesn't ramp up from zero ADC
+  seedFilter(coolantFilter, analogRead(coolantPin));
+  seedFilter(fuelFilter, analogRead(fuelPin));
+  seedFilter(ambientFilter, analogRead(ambientPin));
+  readSensors();
+  resetTrip();
+  resetMarkers();
+  beginCheckpoints();
+
+  runSelfTest();
+  beginWatchdog();
+}
+
+// One display frame: everything that used to run per loop() pass.
+void runFrame(unsigned long lateUs) {
+  unsigned long frameStart = micros();
+  unsigned long mark = frameStart;
+  frameFlashOps = flashOps - (flashWriteActive ? 1 : 0);  // one in progress counts too
+  bool flash = shouldFlash();
+
+  probe(PROBE_UPDATE);
+  if(updateTrip()) requestCheckpoint();  // refuelled: keep the new trip across power loss
+  updateGauges();
+  updateNightMode();
+  updateAlarmSound();
+  updateCheckpoint();
+  endPhase(PHASE_UPDATE, mark);
+
+  probe(PROBE_GLOW);
+  ButtonEvent button = readGlowButton();
+  if(button == BUTTON_LONG) nextPage();
+  handleGlowPlug(button == BUTTON_SHORT);
+  stallPoint(SUB_GLOW);
+  beat(SUB_GLOW);
+  endPhase(PHASE_GLOW, mark);
+
+  probe(PROBE_DRAW);
+  stallPoint(SUB_RENDER);
+  if(digitalRead(glowPin) == HIGH){
+    // glow screen drawn by handleGlowPlug()
+  } else if(testPattern != TEST_OFF){
+    drawTestPattern();
+  } else { // normal pages
+    drawBackground(anyCritical(), flash);
+    pages[currentPage].drawDynamic(flash);
+  }
+
+#if DUAL_VIDEO
+  drawSecondScreen();
+#endif
+  endPhase(PHASE_DRAW, mark);
+  frameTimeUs = mark - frameStart;
+  if(frameTimeUs > frameMaxUs) frameMaxUs = frameTimeUs;
+
+  probe(PROBE_MIRROR);
+  frameRowsChanged();
+  mirrorFrame();
+  endPhase(PHASE_MIRROR, mark);
+  probe(PROBE_TFT);
+  tftFrame();
+  endPhase(PHASE_TFT, mark);
+  recordFrame(mark - frameStart, lateUs);
+  beat(SUB_RENDER);
+  probe(PROBE_IDLE);
+}
+
+void loop() {
+  static unsigned long lastSensorUs = 0, lastTelemetryUs = 0, lastFrameUs = 0, lastMemoryUs = 0;
+  unsigned long now = micros();
+
+  if(now - lastSensorUs >= sensorPeriodUs){
+    lastSensorUs = now;
+    probe(PROBE_SENSORS);
+    readSensors();
+    uint16_t sensorUs = saturate16(micros() - now);
+    if(sensorUs > sensorMaxUs) sensorMaxUs = sensorUs;
+    stallPoint(SUB_ACQUISITION);
+    beat(SUB_ACQUISITION);
+  }
+  if(now - lastTelemetryUs >= telemetryPeriodUs){
+    lastTelemetryUs = now;
+    probe(PROBE_TELEMETRY);
+    sendSnapshot();
+    stallPoint(SUB_LOGGER);
+    beat(SUB_LOGGER);
+  }
+  if(now - lastMemoryUs >= memoryPeriodUs){
+    lastMemoryUs = now;
+    probe(PROBE_TELEMETRY);
+    sampleMemory();
+    sendPacket(PKT_MEMORY, &memStats, sizeof(memStats));
+  }
+  probe(PROBE_CONSOLE);
+  pollConsole();
+  probe(PROBE_IDLE);
+  if(now - lastFrameUs >= framePeriodUs){
+    unsigned long lateUs = now - lastFrameUs - framePeriodUs;
+    lastFrameUs = now;
+    runFrame(lateUs);
+  }
 }
@@ -1,3 +1,9 @@
+// 1 = an oil switch edge repaints the oil banner at once (see "Alarm
+// fast path"); 0 = it waits for the next frame
+#define ALARM_FAST_PATH 1
+// 1 = print the oil edge-to-banner latency on Serial
+#define LATENCY_REPORT 0
+
 #include <TVout.h>
 #include <fontALL.h>
 
@@ -20,11 +26,119 @@ const int fuelLitersMin = 0;
 const int fuelLitersMax = 50;
 const int fuelCriticalLiters = 5;
 
+// Filtering
+const uint8_t filterSamples = 8; // readings averaged per analog input
+
 // Flash settings
 unsigned long lastFlash = 0;
 bool flashState = true;
 const unsigned long flashInterval = 500; // ms
 
+// Frame pacing
+const unsigned long framePeriod = 50; // ms from the start of one frame to the next
+
+// --- Screen layout ---
+// Positions are solved at compile time from a description: rows of
+// rowHeight every rowPitch from the top of the safe area, and columns
+// spread across its width with equal gaps. The safe area is the screen
+// minus the overscan a set of videoStandard typically crops, so a new
+// resolution or standard moves everything with it. The results are
+// plain constants; nothing is computed at run time.
+//
+// TVout's draw_rect(x, y, w, h) and fill_rect cover w + 1 by h + 1
+// pixels, so the bar, the tallest and widest thing in a row, spans one
+// more pixel each way than its arguments.
+const uint8_t videoStandard = PAL;
+const int screenWidth = 120;
+const int screenHeight = 96;
+const int barOutlineW = 42;  // draw_rect arguments of a gauge bar
+const int barOutlineH = 10;
+const int barFillMax = barOutlineW - 2;  // inside the outline
+const int rowPitch = 20;
+const int rowHeight = barOutlineH + 1;
+const int columnCount = 3;
+constexpr int columnWidths[columnCount] = { 16, barOutlineW + 1, 24 };  // label, bar, value with unit
+
+enum Align { ALIGN_START, ALIGN_CENTER, ALIGN_END };
+
+constexpr int overscanPercent(uint8_t standard) { return standard == NTSC ? 7 : 5; }
+constexpr int safeMargin(int size) { return size * overscanPercent(videoStandard) / 100; }
+constexpr int safeSize(int size) { return size - 2 * safeMargin(size); }
+constexpr int widthBefore(int column) { return column == 0 ? 0 : columnWidths[column - 1] + widthBefore(column - 1); }
+constexpr int columnGap() { return (safeSize(screenWidth) - widthBefore(columnCount)) / (columnCount - 1); }
+constexpr int columnX(int column) { return safeMargin(screenWidth) + widthBefore(column) + column * columnGap(); }
+constexpr int alignIn(int start, int cell, int size, Align align) {
+  return align == ALIGN_START ? start : align == ALIGN_END ? start + cell - size : start + (cell - size) / 2;
+}
+constexpr int rowY(int row, int height, Align align) {
+  return alignIn(safeMargin(screenHeight) + row * rowPitch, rowHeight, height, align);
+}
+static_assert(columnGap() >= 0, "layout columns do not fit the safe area");
+static_assert(rowY(2, rowHeight, ALIGN_START) + rowHeight <= screenHeight - safeMargin(screenHeight),
+              "layout rows do not fit the safe area");
+
+const uint8_t labelX = columnX(0);
+const uint8_t barX = columnX(1);
+const uint8_t valueX = columnX(2);
+const uint8_t oilY = rowY(0, 6, ALIGN_CENTER);
+const uint8_t coolantY = rowY(1, rowHeight, ALIGN_START);
+const uint8_t fuelY = rowY(2, rowHeight, ALIGN_START);
+
+// --- Text ---
+// UI strings stay in flash and are streamed to the screen one character
+// at a time with pgm_read_byte, so they cost no SRAM; numbers are
+// formatted into a stack buffer instead of a heap String. The fonts from
+// fontALL.h are PROGMEM tables already. tools/draft_sram.py reports the
+// .data/.bss avr-size gives for any two revisions of this file.
+const unsigned char *const uiFont = font4x6;
+
+const char txtOilWarn[] PROGMEM = "OIL WARN";
+const char txtOilOk[]   PROGMEM = "OIL OK";
+const char txtTemp[]    PROGMEM = "TEMP";
+const char txtFuel[]    PROGMEM = "FUEL";
+const char txtC[]       PROGMEM = "C";
+const char txtL[]       PROGMEM = "L";
+
+void printP(uint8_t x, uint8_t y, const char *text, bool color) {
+  char glyph[2] = { 0, 0 };
+  uint8_t advance = pgm_read_byte(uiFont);  // font header: width, height, first char
+  while ((glyph[0] = pgm_read_byte(text++)) != 0) {
+    TV.print(x, y, glyph, color);
+    x += advance;
+  }
+}
+
+void printNumber(uint8_t x, uint8_t y, int value, bool color) {
+  char digits[7];
+  itoa(value, digits, 10);
+  TV.print(x, y, digits, color);
+}
+
+// --- Filtering ---
+// Box average over the last filterSamples readings, kept in the SRAM the
+// strings used to take. The running sum makes each update O(1).
+struct AdcFilter {
+  int samples[filterSamples];
+  long sum;
+  uint8_t next;
+};
+
+AdcFilter coolantFilter;
+AdcFilter fuelFilter;
+
+void seedFilter(AdcFilter &filter, int adc) {
+  for (uint8_t i = 0; i < filterSamples; i++) filter.samples[i] = adc;
+  filter.sum = (long)adc * filterSamples;
+  filter.next = 0;
+}
+
+int filterAdc(AdcFilter &filter, int adc) {
+  filter.sum += adc - filter.samples[filter.next];
+  filter.samples[filter.next] = adc;
+  filter.next = (filter.next + 1) % filterSamples;
+  return filter.sum / filterSamples;
+}
+
 // --- Helpers ---
 int adcToCoolantC(int adc) {
   return constrain(map(adc, coolantADCMin, coolantADCMax, coolantCMin, coolantCMax), coolantCMin, coolantCMax);
@@ -49,65 +163,150 @@ void drawDegreeSymbol(int x, int y, bool color) {
   TV.set_pixel(x+1, y+1, color);
 }
 
-void drawOilWarning(int oilState, bool flash, bool color) {
-  bool critical = (oilState == HIGH);
-  if (!(critical && !flash)) {
-    if (critical) {
-      TV.print(10, 10, "OIL WARN", color);
-    } else {
-      TV.print(10, 10, "OIL OK", color);
-    }
+void drawOilWarning(int oilState, bool color) {
+  if (oilState == HIGH) {
+    printP(labelX, oilY, txtOilWarn, color);
+  } else {
+    printP(labelX, oilY, txtOilOk, color);
   }
 }
 
-void drawCoolant(int tempC, bool flash, bool color) {
-  bool critical = (tempC >= coolantCriticalC);
-  int barWidth = map(tempC, coolantCMin, coolantCMax, 0, 40);
-  if (!(critical && !flash)) {
-    TV.print(0, 30, "TEMP", color);
-    TV.draw_rect(40, 30, 42, 10, color);
-    TV.fill_rect(41, 31, barWidth, 8, color);
-    TV.print(90, 30, String(tempC).c_str(), color);
-    drawDegreeSymbol(105, 30, color);
-    TV.print(110, 30, "C", color);
-  }
+void drawCoolant(int tempC, bool color) {
+  int barWidth = map(tempC, coolantCMin, coolantCMax, 0, barFillMax);
+  printP(labelX, coolantY, txtTemp, color);
+  TV.draw_rect(barX, coolantY, barOutlineW, barOutlineH, color);
+  TV.fill_rect(barX + 1, coolantY + 1, barWidth, barOutlineH - 2, color);
+  printNumber(valueX, coolantY, tempC, color);
+  drawDegreeSymbol(valueX + 15, coolantY, color);
+  printP(valueX + 20, coolantY, txtC, color);
 }
 
-void drawFuel(int liters, bool flash, bool color) {
-  bool critical = (liters <= fuelCriticalLiters);
-  int barWidth = map(liters, fuelLitersMin, fuelLitersMax, 0, 40);
-  if (!(critical && !flash)) {
-    TV.print(0, 50, "FUEL", color);
-    TV.draw_rect(40, 50, 42, 10, color);
-    TV.fill_rect(41, 51, barWidth, 8, color);
-    TV.print(90, 50, String(liters).c_str(), color);
-    TV.print(110, 50, "L", color);
+void drawFuel(int liters, bool color) {
+  int barWidth = map(liters, fuelLitersMin, fuelLitersMax, 0, barFillMax);
+  printP(labelX, fuelY, txtFuel, color);
+  TV.draw_rect(barX, fuelY, barOutlineW, barOutlineH, color);
+  TV.fill_rect(barX + 1, fuelY + 1, barWidth, barOutlineH - 2, color);
+  printNumber(valueX, fuelY, liters, color);
+  printP(valueX + 20, fuelY, txtL, color);
+}
+
+// --- Retained screen ---
+// The screen is only cleared when the background changes, and a widget
+// is only repainted when what it shows changes: a new value, or the
+// flash phase of a critical widget. Repainting draws the old value
+// again in the background color, which clears exactly its own pixels,
+// then the new one; a hidden widget is just the cleared state, as if it
+// had not been drawn. A steady frame writes nothing to the screen.
+// (Drawing with INVERT would toggle them in one pass, but draw_rect
+// plots its left corners twice, so they would stay lit.)
+const int notDrawn = -1;
+
+struct Widget {
+  int drawnValue;  // value whose pixels are on the screen, or notDrawn
+};
+
+Widget oilWidget     = { notDrawn };
+Widget coolantWidget = { notDrawn };
+Widget fuelWidget    = { notDrawn };
+int drawnBackground  = notDrawn;
+
+void updateWidget(Widget &widget, int value, bool critical, bool flash, bool color,
+                  void (*draw)(int, bool)) {
+  int shown = (critical && !flash) ? notDrawn : value;
+  if (shown == widget.drawnValue) return;
+  if (widget.drawnValue != notDrawn) draw(widget.drawnValue, !color);
+  if (shown != notDrawn) draw(shown, color);
+  widget.drawnValue = shown;
+}
+
+void invalidateScreen() {
+  oilWidget.drawnValue = coolantWidget.drawnValue = fuelWidget.drawnValue = notDrawn;
+}
+
+// --- Alarm fast path ---
+// The oil switch interrupts on both edges (pin 2, INT0); the ISR only
+// timestamps the first edge since the banner was last painted. With
+// ALARM_FAST_PATH the wait between frames watches for that edge and
+// repaints just the oil banner at once, in the colors of the screen as
+// it is; a background change and the other widgets follow on the next
+// frame. Without it the edge waits out the rest of the 50 ms pause and
+// is painted by the frame, first in line.
+//
+// Either way paintOil() measures the time from the edge to the banner
+// being in TV.screen: the last value and the worst since boot. TVout
+// shows it when the scan next passes the banner's lines, up to one
+// field (20 ms PAL) later.
+volatile bool oilEdgePending = false;
+volatile unsigned long oilEdgeUs;
+unsigned long alarmLatencyUs = 0;
+unsigned long alarmLatencyMaxUs = 0;
+
+void oilEdgeIsr() {
+  if (oilEdgePending) return;
+  oilEdgeUs = micros();
+  oilEdgePending = true;
+}
+
+// Reads the switch itself, after taking the edge, so the painted state
+// is never older than the edge it is timed against.
+void paintOil(bool flash, bool textColor) {
+  noInterrupts();
+  bool pending = oilEdgePending;
+  unsigned long edgeUs = oilEdgeUs;
+  oilEdgePending = false;
+  interrupts();
+
+  int oilState = digitalRead(oilPin);
+  updateWidget(oilWidget, oilState, oilState == HIGH, flash, textColor, drawOilWarning);
+  if (!pending) return;
+
+  alarmLatencyUs = micros() - edgeUs;
+  if (alarmLatencyUs > alarmLatencyMaxUs) alarmLatencyMaxUs = alarmLatencyUs;
+#if LATENCY_REPORT
+  Serial.print("oil edge to banner us ");
+  Serial.print(alarmLatencyUs);
+  Serial.print(" max ");
+  Serial.println(alarmLatencyMaxUs);
+#endif
+}
+
+void waitForNextFrame(unsigned long frameStart, bool flash, bool textColor) {
+  while (millis() - frameStart < framePeriod) {
+#if ALARM_FAST_PATH
+    if (oilEdgePending) paintOil(flash, textColor);
+#endif
   }
 }
 
 void setup() {
   pinMode(oilPin, INPUT);
-  TV.begin(PAL, 120, 96);
-  TV.select_font(font4x6);
+  attachInterrupt(digitalPinToInterrupt(oilPin), oilEdgeIsr, CHANGE);
+#if LATENCY_REPORT
+  Serial.begin(115200);
+#endif
+  TV.begin(videoStandard, screenWidth, screenHeight);
+  TV.select_font(uiFont);
+  seedFilter(coolantFilter, analogRead(coolantPin));
+  seedFilter(fuelFilter, analogRead(fuelPin));
 }
 
 void loop() {
+  unsigned long frameStart = millis();
   bool flash = shouldFlash();
   
   int oilState = digitalRead(oilPin);
-  int coolantADC = analogRead(coolantPin);
-  int fuelADC = analogRead(fuelPin);
+  int coolantADC = filterAdc(coolantFilter, analogRead(coolantPin));
+  int fuelADC = filterAdc(fuelFilter, analogRead(fuelPin));
   int coolantC = adcToCoolantC(coolantADC);
   int fuelLiters = adcToFuelLiters(fuelADC);
 
   bool warningMode = (oilState == HIGH) || (coolantC >= coolantCriticalC) || (fuelLiters <= fuelCriticalLiters);
 
-  if (warningMode) {
-    // Fill screen ON (bright)
-    TV.fill(1);
-  } else {
-    // Fill screen OFF (dark)
-    TV.fill(0);
+  if (warningMode != drawnBackground) {
+    // Screen ON (bright) in warning mode, OFF (dark) otherwise
+    TV.fill(warningMode ? 1 : 0);
+    drawnBackground = warningMode;
+    invalidateScreen();
   }
 
   // Decide text color so it's always white against background:
@@ -115,9 +314,9 @@ void loop() {
   // White on bright: invert logic so text stands out, color=0
   bool textColor = warningMode ? 0 : 1;
 
-  drawOilWarning(oilState, flash, textColor);
-  drawCoolant(coolantC, flash, textColor);
-  drawFuel(fuelLiters, flash, textColor);
+  paintOil(flash, textColor);
+  updateWidget(coolantWidget, coolantC, coolantC >= coolantCriticalC, flash, textColor, drawCoolant);
+  updateWidget(fuelWidget, fuelLiters, fuelLiters <= fuelCriticalLiters, flash, textColor, drawFuel);
 
-  delay(50);
+  waitForNextFrame(frameStart, flash, textColor);
 }
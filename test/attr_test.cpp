@@ -0,0 +1,121 @@
+// Builds color.cpp with ATTR_VIDEO and drives the scanout line builder
+// by hand (the scanout task never runs on the host): checks the sync,
+// burst and blanking layout of every line of a field, that a line draws
+// no more than attrSpritesPerLine sprites with every sprite on it, and
+// what the worst such line costs. test_firmware.py builds and runs it.
+#define ATTR_VIDEO 1
+#include "../color.cpp"
+
+int failures = 0;
+
+#define CHECK(cond) do { \
+    if(!(cond)){ fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+  } while(0)
+
+const int lineWords = attrLineSamples * attrScreens;
+const int activeLeft = attrActiveStart + (attrActiveSamples - screenWidth * attrPixelSamples) / 2;
+const int activeRight = activeLeft + screenWidth * attrPixelSamples;
+
+uint8_t level(const uint16_t *line, int s) { return line[sampleIndex(s, 0)] >> 8; }
+
+// Samples [from, to) all at one DAC level.
+bool flat(const uint16_t *line, int from, int to, uint8_t code) {
+  for(int s = from; s < to; s++) if(level(line, s) != code) return false;
+  return true;
+}
+
+void testFieldLayout() {
+  for(int line = 0; line < attrFieldLines; line++){
+    const uint16_t *out = graphics.buildLines(line);
+    if(line < attrBroadLines + attrEqualLines){
+      int pulse = line < attrBroadLines ? attrBroadSamples : attrEqualSamples;
+      for(int half = 0; half < attrLineSamples; half += attrHalfLine){
+        CHECK(flat(out, half, half + pulse, attrLevelSync));
+        CHECK(flat(out, half + pulse, half + attrHalfLine, attrLevelBlank));
+      }
+      continue;
+    }
+    CHECK(flat(out, 0, attrSyncSamples, attrLevelSync));
+    CHECK(flat(out, attrSyncSamples, attrBurstStart, attrLevelBlank));
+    bool burstSwings = false;
+    for(int s = attrBurstStart; s < attrBurstStart + attrBurstSamples; s++){
+      CHECK(level(out, s) != attrLevelSync);
+      burstSwings |= level(out, s) != attrLevelBlank;
+    }
+    CHECK(burstSwings);
+    CHECK(flat(out, attrBurstStart + attrBurstSamples, activeLeft, attrLevelBlank));
+    CHECK(flat(out, activeRight, attrLineSamples, attrLevelBlank));
+    int row = (line - attrFirstLine) / attrLineRepeat;
+    if(line < attrFirstLine || row >= screenHeight) CHECK(flat(out, activeLeft, activeRight, attrLevelBlank));
+    else for(int s = activeLeft; s < activeRight; s++) CHECK(level(out, s) != attrLevelSync);
+  }
+}
+
+// Every sprite slot filled, all on the same rows, side by side: a line
+// through them is the most a line ever draws.
+const int spriteTop = 40;
+const int spriteLine = attrFirstLine + (spriteTop + 5) * attrLineRepeat;
+const unsigned char solidSprite[attrSpriteSize * 2] = {
+  0xFF,0xFF, 0xFF,0xFF, 0xFF,0xFF, 0xFF,0xFF, 0xFF,0xFF, 0xFF,0xFF, 0xFF,0xFF, 0xFF,0xFF,
+  0xFF,0xFF, 0xFF,0xFF, 0xFF,0xFF, 0xFF,0xFF, 0xFF,0xFF, 0xFF,0xFF, 0xFF,0xFF, 0xFF,0xFF,
+};
+uint16_t lineCopy[attrLineSamples * attrScreens];
+
+void showSprites(int from, int to) {
+  graphics.hideSprites();
+  for(int slot = from; slot < to; slot++){
+    graphics.setSprite(slot, solidSprite, WHITE);
+    graphics.moveSprite(slot, slot * attrSpriteSize, spriteTop);
+  }
+}
+
+void testSpritesPerLineCapped() {
+  graphics.fillScreen(BLACK);
+  showSprites(0, attrSpritesPerLine);
+  memcpy(lineCopy, graphics.buildLines(spriteLine), sizeof(lineCopy));
+  showSprites(0, attrMaxSprites);
+  CHECK(memcmp(lineCopy, graphics.buildLines(spriteLine), sizeof(lineCopy)) == 0);  // the rest are left out
+
+  showSprites(0, 0);
+  CHECK(memcmp(lineCopy, graphics.buildLines(spriteLine), sizeof(lineCopy)) != 0);  // and those shown do show
+}
+
+// On the host this bounds the builder's work, not the chip's timing
+// ("perf" reports that): the worst line, best of many builds so a
+// preempted run does not count, must fit the 64 us line at 240 MHz,
+// and the field's maximum must have been recorded.
+void testWorstLineCost() {
+  showSprites(0, attrMaxSprites);
+  graphics.lineCyclesMax = 0;
+  for(int line = 0; line < attrFieldLines; line++) graphics.buildLines(line);
+  CHECK(graphics.lineCyclesMax > 0);
+
+  uint32_t best = UINT32_MAX;
+  for(int i = 0; i < 200; i++){
+    uint32_t before = graphics.lineCyclesMax;
+    graphics.lineCyclesMax = 0;
+    graphics.buildLines(spriteLine);
+    best = min(best, (uint32_t)graphics.lineCyclesMax);
+    graphics.lineCyclesMax = max(before, (uint32_t)graphics.lineCyclesMax);
+  }
+  const uint32_t lineBudget = 64 * 240;
+  if(best >= lineBudget) fprintf(stderr, "worst line %u cycles, budget %u\n", (unsigned)best, (unsigned)lineBudget);
+  CHECK(best < lineBudget);
+  CHECK(graphics.lineCyclesMax >= best);
+  graphics.hideSprites();
+}
+
+int main() {
+  hostAnalog[coolantPin] = 500;
+  hostAnalog[fuelPin] = 500;
+  hostAnalog[ambientPin] = 2500;
+  hostConsoleOut = fopen("/dev/null", "w");
+  setup();
+
+  testFieldLayout();
+  testSpritesPerLineCapped();
+  testWorstLineCost();
+
+  if(failures) fprintf(stderr, "%d check(s) failed\n", failures);
+  return failures ? 1 : 0;
+}
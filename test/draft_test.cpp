@@ -0,0 +1,99 @@
+// Runs draft.cpp (the AVR TVout sketch) on the host TVout model and
+// compares every frame with a golden image: the frame as the sketch drew
+// it before the retained screen, cleared and fully redrawn with critical
+// widgets left out in the off phase of the flash. Also checks that a
+// steady frame writes nothing. test_firmware.py builds and runs it.
+#include "Arduino.h"  // the Arduino build prepends it to every sketch
+#include "../draft.cpp"
+
+int failures = 0;
+
+#define CHECK(cond) do { \
+    if(!(cond)){ fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+  } while(0)
+
+const int screenBytes = screenWidth / 8 * screenHeight;
+uint8_t golden[screenBytes];
+
+// The frame loop() just drew, from the same readings and flash phase,
+// the way the sketch drew every frame before.
+void renderGolden() {
+  uint8_t *screen = TV.screen;
+  TV.screen = golden;
+  int oilState = digitalRead(oilPin);
+  int coolantC = adcToCoolantC(coolantFilter.sum / filterSamples);
+  int fuelLiters = adcToFuelLiters(fuelFilter.sum / filterSamples);
+  bool oilCritical = oilState == HIGH;
+  bool coolantCritical = coolantC >= coolantCriticalC;
+  bool fuelCritical = fuelLiters <= fuelCriticalLiters;
+  bool warningMode = oilCritical || coolantCritical || fuelCritical;
+  bool textColor = warningMode ? 0 : 1;
+  TV.fill(warningMode ? 1 : 0);
+  if (!(oilCritical && !flashState)) drawOilWarning(oilState, textColor);
+  if (!(coolantCritical && !flashState)) drawCoolant(coolantC, textColor);
+  if (!(fuelCritical && !flashState)) drawFuel(fuelLiters, textColor);
+  TV.screen = screen;
+}
+
+// Prints both images so a failure can be seen.
+void dumpMismatch(int frame) {
+  fprintf(stderr, "frame %d differs (left drawn, right golden):\n", frame);
+  for (int y = 0; y < screenHeight; y++) {
+    for (int x = 0; x < screenWidth; x++) fputc(TV.screen[y * screenWidth / 8 + x / 8] & (0x80 >> (x & 7)) ? '#' : '.', stderr);
+    fputs("  ", stderr);
+    for (int x = 0; x < screenWidth; x++) fputc(golden[y * screenWidth / 8 + x / 8] & (0x80 >> (x & 7)) ? '#' : '.', stderr);
+    fputc('\n', stderr);
+  }
+}
+
+struct Step {
+  int frames;
+  int oil, coolantADC, fuelADC;
+};
+
+// Normal, each gauge critical in turn (values still moving while they
+// flash), two at once, oil, and back; long enough to see several flash
+// toggles in each.
+const Step steps[] = {
+  { 30, LOW,  600, 700 },
+  { 10, LOW,  640, 660 },
+  { 40, LOW,  850, 660 },   // coolant critical
+  { 30, LOW,  890, 660 },
+  { 40, LOW,  600, 120 },   // fuel critical
+  { 30, LOW,  880, 100 },   // both
+  { 30, HIGH, 600, 700 },   // oil
+  { 30, LOW,  600, 700 },
+};
+
+int main() {
+  hostAnalog[coolantPin] = steps[0].coolantADC;
+  hostAnalog[fuelPin] = steps[0].fuelADC;
+  setup();
+
+  int frame = 0, mismatches = 0;
+  for (const Step &step : steps) {
+    hostPins[oilPin] = step.oil;
+    hostAnalog[coolantPin] = step.coolantADC;
+    hostAnalog[fuelPin] = step.fuelADC;
+    for (int i = 0; i < step.frames; i++, frame++) {
+      loop();
+      renderGolden();
+      if (memcmp(TV.screen, golden, screenBytes) != 0 && mismatches++ == 0) dumpMismatch(frame);
+    }
+  }
+  CHECK(mismatches == 0);
+
+  // Readings settled and nothing critical: the next frames only compare.
+  int flipsBefore = 0;
+  for (int i = 0; i < 20; i++) {
+    bool phase = flashState;
+    unsigned long writes = TV.pixelWrites;
+    loop();
+    flipsBefore += phase != flashState;
+    CHECK(TV.pixelWrites == writes);
+  }
+  CHECK(flipsBefore > 0);  // the flash phase moved, and still nothing was drawn
+
+  if (failures) fprintf(stderr, "%d check(s) failed\n", failures);
+  return failures ? 1 : 0;
+}
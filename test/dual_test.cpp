@@ -0,0 +1,77 @@
+// Builds color.cpp with DUAL_VIDEO and checks that the second screen is
+// retained: a refresh with nothing changed leaves its frame as it was,
+// and a changed figure repaints only its own text rows. The frame is
+// read back through the scanout line builder (screen 1's samples).
+// test_firmware.py builds and runs it.
+#define ATTR_VIDEO 1
+#define DUAL_VIDEO 1
+#include "../color.cpp"
+
+int failures = 0;
+
+#define CHECK(cond) do { \
+    if(!(cond)){ fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+  } while(0)
+
+uint8_t shown[attrFieldLines][attrLineSamples];  // screen 1, DAC codes
+
+// Lines of the field whose screen 1 samples differ from `shown`, and
+// refreshes `shown`; first and last such line in `first`/`last`.
+int changedLines(int &first, int &last) {
+  int changed = 0;
+  first = last = -1;
+  for(int line = 0; line < attrFieldLines; line++){
+    const uint16_t *out = graphics.buildLines(line);
+    bool differs = false;
+    for(int s = 0; s < attrLineSamples; s++){
+      uint8_t code = out[sampleIndex(s, 1)] >> 8;
+      differs |= code != shown[line][s];
+      shown[line][s] = code;
+    }
+    if(!differs) continue;
+    if(first < 0) first = line;
+    last = line;
+    changed++;
+  }
+  return changed;
+}
+
+void refreshSecondScreen() {
+  hostAdvanceMs(secondScreenPeriodMs);
+  frameTextBuilds = 0;
+  drawSecondScreen();
+}
+
+void testSteadyRefreshLeavesFrame() {
+  int first, last;
+  drawSecondScreen();
+  changedLines(first, last);
+  refreshSecondScreen();
+  CHECK(frameTextBuilds == 0);
+  CHECK(changedLines(first, last) == 0);
+}
+
+void testChangedValueRepaintsOnlyItsRow() {
+  int first, last;
+  const ValueLabel &label = secondValues[1];  // max coolant
+  trip.maxCoolantC += 7;
+  refreshSecondScreen();
+  CHECK(frameTextBuilds == 1);
+  CHECK(changedLines(first, last) > 0);
+  CHECK(first >= attrFirstLine + label.y * attrLineRepeat);
+  CHECK(last < attrFirstLine + (label.y + 8) * attrLineRepeat);
+}
+
+int main() {
+  hostAnalog[coolantPin] = 500;
+  hostAnalog[fuelPin] = 500;
+  hostAnalog[ambientPin] = 2500;
+  hostConsoleOut = fopen("/dev/null", "w");
+  setup();
+
+  testSteadyRefreshLeavesFrame();
+  testChangedValueRepaintsOnlyItsRow();
+
+  if(failures) fprintf(stderr, "%d check(s) failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+// Runs the sketch on the host and writes its telemetry stream to stdout,
+// for the tools/ tests. Sensor inputs ramp and the oil switch closes half
+// way through. Alongside the stream it writes:
+//   argv[1]  one line per snapshot sent: seq coolantC fuelLiters oilCritical
+//   argv[2]  the mirror shadow after the last PKT_MIRROR_FRAME, raw bytes
+#include "../color.cpp"
+
+uint32_t framesRun() {
+  uint32_t n = 0;
+  for(int i = 0; i < histBuckets; i++) n += frameHist[i];
+  return n;
+}
+
+int main(int argc, char **argv) {
+  if(argc != 3) return 2;
+  FILE *expect = fopen(argv[1], "w");
+  hostAnalog[coolantPin] = 200;
+  hostAnalog[fuelPin] = 880;
+  hostAnalog[ambientPin] = 2500;
+  setup();
+
+  const int steps = 600;  // 3 s at 5 ms
+  for(int i = 0; ; i++){
+    hostAnalog[coolantPin] = 200 + i;
+    hostAnalog[fuelPin] = 880 - i;
+    hostPins[oilPin] = i >= steps / 2 ? HIGH : LOW;
+
+    uint16_t seq = telemetrySeq;
+    uint32_t frames = framesRun();
+    hostAdvanceMs(5);
+    loop();
+    if(telemetrySeq != seq){
+      fprintf(expect, "%u %d %d %d\n", seq, sensors.coolantC, sensors.fuelLiters,
+              sensors.oilCritical ? 1 : 0);
+    }
+    // On the host the scan never runs out of TX room, so a frame that
+    // leaves it at tile 0 has just sent PKT_MIRROR_FRAME.
+    if(i >= steps && framesRun() != frames && mirrorNextTile == 0) break;
+  }
+  fclose(expect);
+
+  FILE *shadow = fopen(argv[2], "wb");
+  fwrite(mirrorShadow, 1, screenWidth * screenHeight, shadow);
+  fclose(shadow);
+  fflush(stdout);
+  return 0;
+}
@@ -0,0 +1,523 @@
+// Runs pieces of color.cpp on the host (test/host) and checks what they
+// do. Prints one line per failed check and exits non-zero if any failed;
+// test_firmware.py builds and runs it.
+#include "../color.cpp"
+#include <chrono>
+#include <string>
+#include <thread>
+
+int failures = 0;
+
+#define CHECK(cond) do { \
+    if(!(cond)){ fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+  } while(0)
+
+void console(const char *text) {
+  char line[consoleLineMax + 1];
+  strncpy(line, text, consoleLineMax);
+  line[consoleLineMax] = 0;
+  runConsoleLine(line);
+}
+
+// -------------------------------------------------------------------
+// Trip
+void testTripRestoredFromCheckpoint() {
+  Checkpoint cp;
+  captureCheckpoint(cp);
+  cp.tripSeconds = 3600;
+  cp.tripStartFuelLiters = 40;
+  cp.tripMinFuelLiters = 20;
+  restoreCheckpoint(cp);
+  sensors.fuelLiters = 20 + tripRefuelLiters - 1;  // sloshing, not a refill
+  CHECK(!updateTrip());
+  CHECK(trip.startFuelLiters == 40);
+  CHECK((millis() - trip.startMs) / 1000 == 3600);
+}
+
+void testTripEndsOnRefuel() {
+  Checkpoint cp;
+  captureCheckpoint(cp);
+  cp.tripSeconds = 3600;
+  cp.tripStartFuelLiters = 40;
+  cp.tripMinFuelLiters = 20;
+  restoreCheckpoint(cp);  // as after a boot, with the tank filled while off
+  sensors.fuelLiters = 45;
+  CHECK(updateTrip());
+  CHECK(trip.startFuelLiters == 45);
+  CHECK(trip.minFuelLiters == 45);
+  CHECK(millis() - trip.startMs < 1000);
+}
+
+void testTripResetCommand() {
+  Checkpoint cp;
+  captureCheckpoint(cp);
+  cp.tripSeconds = 3600;
+  cp.tripMaxCoolantC = 110;
+  restoreCheckpoint(cp);
+  checkpointTaskHandle = &cp;  // any handle; the host task never runs
+  int notifies = hostNotifies;
+  console("trip reset");
+  checkpointTaskHandle = NULL;
+  CHECK(hostNotifies == notifies + 1);  // the new trip is checkpointed
+  CHECK(checkpointLive.tripMaxCoolantC == sensors.coolantC);  // and published before the task woke
+  CHECK(trip.maxCoolantC == sensors.coolantC);
+  CHECK(millis() - trip.startMs < 1000);
+}
+
+// -------------------------------------------------------------------
+// Checkpoints
+// Each test starts from a blank partition the task would write to.
+void useBlankFlash() {
+  memset(hostFlash, 0xFF, sizeof(hostFlash));
+  hostFlashPresent = true;
+  checkpointPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "ckpt");
+  checkpointSlot = 0;
+}
+
+void dropFlash() {
+  hostFlashPresent = false;
+  hostFlashFailWrites = 0;
+  checkpointPartition = NULL;
+}
+
+Checkpoint storedCheckpoint(int slot) {
+  Checkpoint cp;
+  memcpy(&cp, hostFlash + slot * checkpointSlotBytes, sizeof(cp));
+  return cp;
+}
+
+// The failed program leaves half a record; the retry, with newer
+// readings, must land on an erased slot and read back valid.
+void testFailedCheckpointWriteIsRetriedOnErasedSlot() {
+  useBlankFlash();
+  sensors.fuelLiters = 30;
+  publishCheckpoint();
+  hostFlashFailWrites = 1;
+  uint32_t failures = checkpointFailures;
+  CHECK(!writeCheckpoint());
+  CHECK(checkpointFailures == failures + 1);
+  CHECK(checkpointSlot == 0);
+
+  sensors.fuelLiters = 29;
+  publishCheckpoint();
+  CHECK(writeCheckpoint());
+  Checkpoint stored = storedCheckpoint(0);
+  CHECK(checkpointValid(stored));
+  CHECK(stored.fuelLiters == 29);
+  CHECK(stored.version == checkpointVersion);
+  CHECK(checkpointSlot == 1);
+  CHECK(storedCheckpoint(1).magic == 0xFFFFFFFF);  // next target erased ahead
+  dropFlash();
+}
+
+void testCheckpointOfOtherLayoutIgnored() {
+  Checkpoint cp;
+  captureCheckpoint(cp);
+  cp.version = checkpointVersion + 1;
+  cp.crc = crc16((const uint8_t *)&cp, offsetof(Checkpoint, crc));
+  CHECK(!checkpointValid(cp));
+  cp.version = checkpointVersion;
+  cp.crc = crc16((const uint8_t *)&cp, offsetof(Checkpoint, crc));
+  CHECK(checkpointValid(cp));
+}
+
+void testCheckpointCalibrationKeepsFullRange() {
+  int saved = fuelADCMax;
+  Checkpoint cp;
+  fuelADCMax = 4095;
+  captureCheckpoint(cp);
+  fuelADCMax = saved;
+  restoreCheckpoint(cp);
+  CHECK(fuelADCMax == 4095);
+
+  cp.calibration[0] = cp.calibration[1];  // coolantADCMin == coolantADCMax: empty scale
+  int coolantMin = coolantADCMin;
+  restoreCheckpoint(cp);
+  CHECK(coolantADCMin == coolantMin);
+  CHECK(fuelADCMax == 4095);  // the whole table is kept, not just the bad entry
+  CHECK(calibrationValid());
+  fuelADCMax = saved;
+  applyCalibration();
+}
+
+// -------------------------------------------------------------------
+// Self-test row
+// Drawn inside the safe area, so overscan cannot crop it; the stall line
+// above it too.
+void testSelfTestRowInSafeArea() {
+  CHECK(millis() < selfTestShowMs);
+  lastStall.magic = stallMagic;
+  const char sentinel = 0x55;
+  for(int y = 0; y < screenHeight; y++) memset(graphics.backbuffer[y], sentinel, screenWidth);
+  selfTestRowState = notDrawn;
+  drawSelfTestRow();
+  lastStall.magic = 0;
+
+  int top = screenHeight, bottom = -1, left = screenWidth, right = -1;
+  for(int y = 0; y < screenHeight; y++){
+    for(int x = 0; x < screenWidth; x++){
+      // The row's background fill spans the width; the text must not.
+      bool text = graphics.backbuffer[y][x] != sentinel && graphics.backbuffer[y][x] != (char)screenBg;
+      if(graphics.backbuffer[y][x] != sentinel){
+        top = min(top, y);
+        bottom = max(bottom, y);
+      }
+      if(text){
+        left = min(left, x);
+        right = max(right, x);
+      }
+    }
+  }
+  CHECK(top >= safeMargin(screenHeight));
+  CHECK(bottom < screenHeight - safeMargin(screenHeight));
+  CHECK(left >= safeMargin(screenWidth));
+  CHECK(right < screenWidth - safeMargin(screenWidth));
+  CHECK(bottom - top == 15);  // stall line and results row
+}
+
+// -------------------------------------------------------------------
+// Console calibration
+void testCalRejectsBadValues() {
+  int adcMin = coolantADCMin, adcMax = coolantADCMax;
+  console("cal coolantADCMax abc");
+  console("cal coolantADCMax 12x");
+  console("cal coolantADCMax");  // prints only
+  CHECK(coolantADCMax == adcMax);
+  console("cal coolantADCMax 5000");  // beyond the 12-bit ADC
+  CHECK(coolantADCMax == adcMax);
+  console("cal coolantADCMax 100");   // min == max: map() would divide by zero
+  CHECK(coolantADCMax == adcMax);
+  console("cal coolantADCMin 950");   // min > max
+  CHECK(coolantADCMin == adcMin);
+  CHECK(calibrationValid());
+
+  console("cal coolantADCMax 950");
+  CHECK(coolantADCMax == 950);
+  console("cal coolantADCMin -0");
+  CHECK(coolantADCMin == 0);
+  coolantADCMin = adcMin;
+  coolantADCMax = adcMax;
+}
+
+// -------------------------------------------------------------------
+// Audible alarms
+// What the buzzer plays over the next steps timer steps, one character
+// per toneStepMs: '#' on, '.' off.
+std::string listen(int steps) {
+  std::string heard;
+  for(int i = 0; i < steps; i++){
+    heard += hostLedcDuty ? '#' : '.';
+    hostTimerTick();
+  }
+  return heard;
+}
+
+void setAlarms(bool oil, bool coolant, bool fuel) {
+  sensors.oilCritical = oil;
+  sensors.coolantCritical = coolant;
+  sensors.fuelCritical = fuel;
+  updateAlarmSound();
+}
+
+void testToneStepTiming() {
+  CHECK(hostTimerAlarm == toneStepMs * 1000);  // timer runs at 1 MHz
+  CHECK(hostTimerEnabled);
+}
+
+void testFuelChimePlaysOnce() {
+  setAlarms(false, false, false);
+  setAlarms(false, false, true);
+  CHECK(hostLedcFreq == fuelTone.freqHz);
+  CHECK(listen(32) == "######" + std::string(26, '.'));
+  CHECK(activeTone == NULL);  // one-shot: stops after step 31
+  for(int i = 0; i < 40; i++){
+    setAlarms(false, false, true);
+    CHECK(listen(1) == ".");
+  }
+  CHECK(activeTone == NULL);
+}
+
+void testOilPreemptsFuelChime() {
+  setAlarms(false, false, false);
+  setAlarms(false, false, true);
+  CHECK(listen(3) == "###");
+  setAlarms(true, false, true);
+  CHECK(hostLedcFreq == oilTone.freqHz);
+  CHECK(listen(12) == "##..##..##..");  // from step 0 of the oil pattern
+
+  // Oil clears: silence, and the interrupted chime is not played again.
+  setAlarms(false, false, true);
+  CHECK(activeTone == NULL);
+  for(int i = 0; i < 40; i++){
+    setAlarms(false, false, true);
+    CHECK(listen(1) == ".");
+  }
+}
+
+void testOilOverCoolantAndRepeats() {
+  setAlarms(false, false, false);
+  setAlarms(false, true, false);
+  CHECK(hostLedcFreq == coolantTone.freqHz);
+  CHECK(listen(8) == "####....");
+  setAlarms(true, true, false);
+  CHECK(hostLedcFreq == oilTone.freqHz);
+  std::string cycle = "##..##..##" + std::string(22, '.');
+  CHECK(listen(64) == cycle + cycle);
+  listen(5);
+  setAlarms(true, true, false);  // unchanged: no restart mid-pattern
+  CHECK(toneStep == 5 && activeTone == &oilTone);
+  setAlarms(false, true, false);
+  CHECK(hostLedcFreq == coolantTone.freqHz);
+  CHECK(listen(4) == "####");
+  setAlarms(false, false, false);
+  CHECK(activeTone == NULL && hostLedcDuty == 0);
+}
+
+// -------------------------------------------------------------------
+// Frame traces
+const FrameTrace &lastTrace() {
+  return overrunTraces[(overrunNext + overrunTraceCount - 1) % overrunTraceCount];
+}
+
+void testTraceSeesFlashOpDuringFrame() {
+  frameFlashOps = flashOps;
+  recordFrame(frameBudgetUs + 1, 0);
+  CHECK(!lastTrace().flashBusy);
+
+  frameFlashOps = flashOps;
+  beginFlashOp();            // erase started and finished mid-frame
+  flashWriteActive = false;
+  recordFrame(frameBudgetUs + 1, 0);
+  CHECK(lastTrace().flashBusy);
+}
+
+// Print::printf formats into a 64-byte stack buffer and allocates for
+// anything longer.
+void testConsoleLinesFitPrintfBuffer() {
+  recordFrame(0xFFFF, 0xFFFF);
+  for(FrameTrace &trace : overrunTraces){
+    trace.atMs = 0xFFFFFFFF;
+    trace.sensorMaxUs = trace.lateUs = 0xFFFF;
+    trace.textBuilds = 0xFF;
+    trace.flashBusy = true;
+  }
+  hostPrintfMax = 0;
+  console("hist");
+  CHECK(hostPrintfMax < 64);
+
+  const char *const commands[] = { "help", "adc", "cal", "perf", "layout", "mem", "font", "trip" };
+  for(const char *command : commands){
+    hostPrintfMax = 0;
+    console(command);
+    if(hostPrintfMax >= 64) fprintf(stderr, "\"%s\" printed %u bytes at once\n", command, (unsigned)hostPrintfMax);
+    CHECK(hostPrintfMax < 64);
+  }
+}
+
+// -------------------------------------------------------------------
+// Memory soak
+// Runs the loop for soakFrames frames, paging through every page, with
+// the sensors moving. After one pass through the pages to warm up, the
+// arena, the live heap and the free-heap floor must not move again.
+const int soakFrames = 2000;
+
+uint32_t framesRun() {
+  uint32_t total = 0;
+  for(uint32_t count : frameHist) total += count;
+  return total;
+}
+
+void runFrames(int frames) {
+  uint32_t before = framesRun();
+  for(int frame = 0; frame < frames; frame++){
+    hostAnalog[coolantPin] = 300 + frame % 500;
+    hostAnalog[fuelPin] = 800 - frame % 600;
+    if(frame % 100 == 99) nextPage();
+    hostMicros += framePeriodUs;
+    loop();
+  }
+  CHECK(framesRun() - before == (uint32_t)frames);
+}
+
+void testMemoryFlatOverFrames() {
+  runFrames(pageCount * 100);
+  size_t arenaStart = arenaUsed;
+  size_t heapStart = hostHeapUsed;
+  size_t floorStart = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+  unsigned long allocsStart = hostHeapAllocs;
+
+  runFrames(soakFrames);
+  CHECK(arenaUsed == arenaStart);
+  CHECK(hostHeapUsed == heapStart);
+  CHECK(heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL) == floorStart);
+  if(hostHeapAllocs != allocsStart) fprintf(stderr, "%lu allocations in %d frames\n", hostHeapAllocs - allocsStart, soakFrames);
+
+  sampleMemory();  // what DIAG, "mem" and PKT_MEMORY report
+  CHECK(memStats.heapFree == hostHeapBytes - hostHeapUsed);
+  CHECK(memStats.heapMinFree == floorStart);
+  CHECK(memStats.arenaUsed == arenaStart);
+  hostAnalog[coolantPin] = 500;
+  hostAnalog[fuelPin] = 500;
+}
+
+// -------------------------------------------------------------------
+// Watchdog
+void beatAll() {
+  for(uint8_t sub = 0; sub < SUB_COUNT; sub++) beat((Subsystem)sub);
+}
+
+void beatAllBut(Subsystem stalled) {
+  for(uint8_t sub = 0; sub < SUB_COUNT; sub++) if(sub != stalled) beat((Subsystem)sub);
+}
+
+// Runs the watchdog's check; returns the subsystem it rebooted for, or -1.
+int watchdogCheck() {
+  try {
+    checkHeartbeats(millis());
+  } catch(HostRestart &) {
+    return stallRecord.subsystem;
+  }
+  return -1;
+}
+
+void testStaleHeartbeatReboots() {
+  beatAll();
+  CHECK(watchdogCheck() == -1);  // catches up with earlier flash operations
+  hostPins[glowPin] = HIGH;
+  probe(PROBE_DRAW);
+  hostAdvanceMs(heartbeatTimeoutMs[SUB_RENDER] + watchdogPeriodMs);
+  beatAllBut(SUB_RENDER);
+  CHECK(watchdogCheck() == SUB_RENDER);
+  CHECK(stallRecord.probe == PROBE_DRAW);
+  CHECK(stallRecord.magic == stallMagic);
+  CHECK(stallRecord.stalledMs > heartbeatTimeoutMs[SUB_RENDER]);
+  CHECK(hostPins[glowPin] == LOW);  // glow off before the restart
+}
+
+// Both cores stop while the flash is erased: nothing beats, the watchdog
+// included, which sees the stale beats when the erase is over.
+void testFlashEraseIsNotAStall() {
+  beatAll();
+  CHECK(watchdogCheck() == -1);
+  beginFlashOp();
+  hostAdvanceMs(400);
+  CHECK(watchdogCheck() == -1);  // an erase that yields between sectors
+  flashWriteActive = false;
+  CHECK(watchdogCheck() == -1);
+
+  beatAll();
+  hostAdvanceMs(watchdogPeriodMs);
+  CHECK(watchdogCheck() == -1);
+  beginFlashOp();                // started and finished between two checks
+  hostAdvanceMs(400);
+  flashWriteActive = false;
+  CHECK(watchdogCheck() == -1);
+
+  // A subsystem that stays stalled after the erase is still caught.
+  for(unsigned long ms = 0; ms <= heartbeatTimeoutMs[SUB_ACQUISITION]; ms += watchdogPeriodMs){
+    hostAdvanceMs(watchdogPeriodMs);
+    beatAllBut(SUB_ACQUISITION);
+    if(ms < heartbeatTimeoutMs[SUB_ACQUISITION]) CHECK(watchdogCheck() == -1);
+  }
+  CHECK(watchdogCheck() == SUB_ACQUISITION);
+}
+
+void testHungFlashOpReboots() {
+  beatAll();
+  beginFlashOp();
+  int rebootedFor = -1;
+  for(unsigned long ms = 0; ms < flashOpMaxMs + 1000 && rebootedFor < 0; ms += watchdogPeriodMs){
+    hostAdvanceMs(watchdogPeriodMs);
+    rebootedFor = watchdogCheck();
+  }
+  flashWriteActive = false;
+  CHECK(rebootedFor == SUB_ACQUISITION);  // shortest timeout goes first
+  CHECK(stallRecord.stalledMs <= flashOpMaxMs + heartbeatTimeoutMs[SUB_ACQUISITION] + watchdogPeriodMs);
+}
+
+// Nothing on the loop beats while it runs a console command; the time is
+// forgiven up to consoleCommandMaxMs, then the command counts as a hang.
+void testLongConsoleCommandIsNotAStall() {
+  unsigned long before = millis();
+  console("help");
+  CHECK(!consoleCommandActive);
+  CHECK(consoleCommandStartMs >= before);
+
+  beatAll();
+  CHECK(watchdogCheck() == -1);
+  consoleCommandStartMs = millis();  // as runConsoleLine() does around a command
+  consoleCommandActive = true;
+  for(unsigned long ms = 0; ms < consoleCommandMaxMs / 2; ms += watchdogPeriodMs){
+    hostAdvanceMs(watchdogPeriodMs);
+    CHECK(watchdogCheck() == -1);
+  }
+  consoleCommandActive = false;
+  hostAdvanceMs(watchdogPeriodMs);
+  CHECK(watchdogCheck() == -1);  // the loop has its full timeout to beat again
+
+  beatAll();
+  probe(PROBE_CONSOLE);
+  consoleCommandStartMs = millis();
+  consoleCommandActive = true;
+  int rebootedFor = -1;
+  unsigned long ms = 0;
+  for(; ms < consoleCommandMaxMs + 1000 && rebootedFor < 0; ms += watchdogPeriodMs){
+    hostAdvanceMs(watchdogPeriodMs);
+    rebootedFor = watchdogCheck();
+  }
+  consoleCommandActive = false;
+  CHECK(rebootedFor == SUB_ACQUISITION);
+  CHECK(ms > consoleCommandMaxMs);
+  CHECK(stallRecord.probe == PROBE_CONSOLE);
+}
+
+// "stall acq" hangs the next acquisition pass in a second thread, as the
+// loop task would; the watchdog check in this one reboots for it. The
+// hung thread is left spinning, so this runs last.
+void testInjectedStallReboots() {
+  beatAll();
+  probe(PROBE_IDLE);
+  console("stall acq");
+  hostAdvanceMs(watchdogPeriodMs);
+  std::thread loopTask([] { loop(); });
+  loopTask.detach();
+  while(activeProbe != PROBE_SENSORS) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));  // into stallPoint()
+
+  hostAdvanceMs(heartbeatTimeoutMs[SUB_ACQUISITION]);
+  beatAllBut(SUB_ACQUISITION);
+  CHECK(watchdogCheck() == SUB_ACQUISITION);
+  CHECK(stallRecord.probe == PROBE_SENSORS);
+}
+
+int main() {
+  hostAnalog[coolantPin] = 500;
+  hostAnalog[fuelPin] = 500;
+  hostAnalog[ambientPin] = 2500;
+  hostConsoleOut = fopen("/dev/null", "w");
+  setup();
+
+  testSelfTestRowInSafeArea();
+  testCalRejectsBadValues();
+  testToneStepTiming();
+  testFuelChimePlaysOnce();
+  testOilPreemptsFuelChime();
+  testOilOverCoolantAndRepeats();
+  testTripRestoredFromCheckpoint();
+  testTripEndsOnRefuel();
+  testTripResetCommand();
+  testFailedCheckpointWriteIsRetriedOnErasedSlot();
+  testCheckpointOfOtherLayoutIgnored();
+  testCheckpointCalibrationKeepsFullRange();
+  testTraceSeesFlashOpDuringFrame();
+  testConsoleLinesFitPrintfBuffer();
+  testMemoryFlatOverFrames();
+  testStaleHeartbeatReboots();
+  testFlashEraseIsNotAStall();
+  testHungFlashOpReboots();
+  testLongConsoleCommandIsNotAStall();
+  testInjectedStallReboots();
+
+  if(failures) fprintf(stderr, "%d check(s) failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+// Host build of the ESP32 Arduino API, just enough to compile the
+// sketch on a PC for tests. Time, pins and ADC readings are driven by
+// the test through host.h; UART output goes to stdio.
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctype.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+
+#define PROGMEM
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 3
+#define FALLING 2
+#define RISING 1
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define SERIAL_8N1 0x800001c
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define memcpy_P memcpy
+#define digitalPinToInterrupt(p) (p)
+#define A0 14  // analog pin names as the AVR cores have them, for draft.cpp
+#define A1 15
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// As in the ESP32 core: the std templates, so mixed types do not compile.
+using std::min;
+using std::max;
+using std::abs;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned us);
+int digitalRead(int pin);
+void digitalWrite(int pin, int value);
+void pinMode(int pin, int mode);
+int analogRead(int pin);
+void attachInterrupt(int irq, void (*isr)(), int mode);
+void noInterrupts();
+void interrupts();
+char *itoa(int value, char *out, int base);
+uint32_t getCpuFrequencyMhz();
+
+class String {
+public:
+  String(const char *text = "") : s(text) {}
+  String(int value) : s(std::to_string(value)) {}
+  String operator+(const char *text) const { return String((s + text).c_str()); }
+  const char *c_str() const { return s.c_str(); }
+private:
+  std::string s;
+};
+
+class HardwareSerial {
+public:
+  explicit HardwareSerial(FILE *&out) : out(out) {}
+  void begin(long, uint32_t = SERIAL_8N1, int8_t = -1, int8_t = -1) {}
+  void setTxBufferSize(size_t) {}
+  void setRxBufferSize(size_t) {}
+  int available() { return 0; }
+  int read() { return -1; }
+  int availableForWrite() { return 4096; }
+  size_t write(const uint8_t *data, size_t len) { return fwrite(data, 1, len, out); }
+  size_t write(uint8_t b) { return write(&b, 1); }
+  void printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+  void print(const char *text) { fputs(text, out); }
+  void print(int value) { fprintf(out, "%d", value); }
+  void print(unsigned long value) { fprintf(out, "%lu", value); }
+  void println(const char *text = "") { fprintf(out, "%s\n", text); }
+  void println(int value) { fprintf(out, "%d\n", value); }
+  void println(unsigned long value) { fprintf(out, "%lu\n", value); }
+  void flush() { fflush(out); }
+private:
+  FILE *&out;
+};
+extern HardwareSerial Serial;   // console: hostConsoleOut, stderr by default
+extern HardwareSerial Serial2;  // telemetry: hostTelemetryOut, stdout by default
+
+class EspClass {
+public:
+  uint32_t getFreeHeap() { return 200000; }
+  uint32_t getCycleCount();  // a 240 MHz count of real host time, for timings
+  void restart();
+};
+extern EspClass ESP;
+
+typedef struct hw_timer_s hw_timer_t;
+hw_timer_t *timerBegin(uint8_t, uint16_t, bool);
+void timerAttachInterrupt(hw_timer_t *, void (*)(), bool);
+void timerAlarmWrite(hw_timer_t *, uint64_t, bool);
+void timerAlarmEnable(hw_timer_t *);
+void timerAlarmDisable(hw_timer_t *);
+double ledcSetup(uint8_t, double, uint8_t);
+void ledcAttachPin(uint8_t, uint8_t);
+void ledcWrite(uint8_t, uint32_t);
+double ledcWriteTone(uint8_t, double);
+
+// FreeRTOS: tasks are created but never run; tests call task bodies'
+// pieces directly.
+typedef void *TaskHandle_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffff
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(x) (x)
+#define configMAX_PRIORITIES 25
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+inline void portENTER_CRITICAL(portMUX_TYPE *) {}
+inline void portEXIT_CRITICAL(portMUX_TYPE *) {}
+inline void portENTER_CRITICAL_ISR(portMUX_TYPE *) {}
+inline void portEXIT_CRITICAL_ISR(portMUX_TYPE *) {}
+inline void portYIELD_FROM_ISR() {}
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t);
+BaseType_t xTaskNotifyGive(TaskHandle_t);
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *);
+BaseType_t xTaskCreatePinnedToCore(void (*)(void *), const char *, uint32_t, void *, UBaseType_t, TaskHandle_t *, BaseType_t);
+void vTaskDelay(TickType_t);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t);
+void enableLoopWDT();
+void feedLoopWDT();
+
+#include "host.h"
@@ -0,0 +1,28 @@
+// Host CompositeGraphics: a plain byte-per-pixel backbuffer. Rectangles
+// and bitmaps are drawn; text is drawn as one filled cell per character
+// so tests can see where it went.
+#pragma once
+#include "CompositeVideo.h"
+#include <stdint.h>
+class String;
+
+class CompositeGraphics {
+public:
+  char **backbuffer = nullptr;
+  CompositeGraphics(CompositeVideo::Mode, int width, int height);
+  void begin() {}
+  void setFont(int) {}
+  void setHue(uint16_t color) { hue = color; }
+  void setCursor(int x, int y) { cursorX = x; cursorY = y; }
+  void print(const char *text);
+  void print(int value);
+  void print(const String &text);
+  void fillScreen(uint16_t color) { fillRect(0, 0, width, height, color); }
+  void fillRect(int x, int y, int w, int h, uint16_t color);
+  void drawRect(int x, int y, int w, int h, uint16_t color);
+  void drawBitmap(int x, int y, const unsigned char *bitmap, int w, int h, uint16_t color);
+private:
+  int width, height;
+  uint16_t hue = 0;
+  int cursorX = 0, cursorY = 0;
+};
@@ -0,0 +1,4 @@
+#pragma once
+struct CompositeVideo {
+  enum Mode { PAL, NTSC };
+};
@@ -0,0 +1,14 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+// Nothing is stored: every key reads as missing.
+class Preferences {
+public:
+  bool begin(const char *, bool = false) { return true; }
+  void end() {}
+  uint32_t getULong(const char *, uint32_t fallback = 0) { return fallback; }
+  size_t putULong(const char *, uint32_t) { return 4; }
+  size_t putBytes(const char *, const void *, size_t len) { return len; }
+  size_t getBytes(const char *, void *, size_t) { return 0; }
+  size_t getBytesLength(const char *) { return 0; }
+};
@@ -0,0 +1,87 @@
+// Host TVout: the 1bpp frame buffer and drawing calls draft.cpp uses,
+// with TVout's pixel coverage (rows drawn by draw_row stop short of x1,
+// columns include y1, so draw_rect and fill_rect cover w + 1 by h + 1).
+// print() sets the glyph's lit pixels to the color and leaves the rest.
+// Header-only: only draft.cpp includes it. Counts pixel writes so tests
+// can see what a frame touched.
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+#define PAL 1
+#define NTSC 0
+#define WHITE 1
+#define BLACK 0
+#define INVERT 2
+
+class TVout {
+public:
+  uint8_t *screen = nullptr;
+  unsigned long pixelWrites = 0;
+
+  char begin(uint8_t, uint8_t x, uint8_t y) {
+    width = x;
+    height = y;
+    screen = new uint8_t[x / 8 * y]();
+    return 0;
+  }
+  unsigned char hres() { return width; }
+  unsigned char vres() { return height; }
+  void select_font(const unsigned char *f) { font = f; }
+  void delay_frame(unsigned int) {}
+
+  void fill(uint8_t color) {
+    for(int i = 0; i < width / 8 * height; i++) screen[i] = color == INVERT ? ~screen[i] : color ? 0xFF : 0;
+    pixelWrites += width * height;
+  }
+
+  void set_pixel(uint8_t x, uint8_t y, char c) {
+    if(x >= width || y >= height) return;
+    uint8_t &byte = screen[y * (width / 8) + x / 8];
+    uint8_t bit = 0x80 >> (x & 7);
+    if(c == WHITE) byte |= bit;
+    else if(c == BLACK) byte &= ~bit;
+    else if(c == INVERT) byte ^= bit;
+    pixelWrites++;
+  }
+
+  void draw_rect(uint8_t x0, uint8_t y0, uint8_t w, uint8_t h, char c, char fc = -1) {
+    if(fc != -1){
+      for(int y = y0; y < y0 + h; y++) draw_row(y, x0, x0 + w, fc);
+    }
+    draw_line(x0, y0, x0 + w, y0, c);
+    draw_line(x0, y0, x0, y0 + h, c);
+    draw_line(x0 + w, y0, x0 + w, y0 + h, c);
+    draw_line(x0, y0 + h, x0 + w, y0 + h, c);
+  }
+  void fill_rect(uint8_t x0, uint8_t y0, uint8_t w, uint8_t h, char c) { draw_rect(x0, y0, w, h, c, c); }
+
+  void print(uint8_t x, uint8_t y, const char *text, char c = WHITE) {
+    for(; *text; text++, x += font[0]) print_char(x, y, *text, c);
+  }
+
+private:
+  int width = 0, height = 0;
+  const unsigned char *font = nullptr;
+
+  void print_char(uint8_t x, uint8_t y, unsigned char ch, char c) {
+    uint8_t w = font[0], h = font[1];
+    const unsigned char *rows = font + 3 + (ch - font[2]) * h;
+    for(uint8_t row = 0; row < h; row++){
+      for(uint8_t col = 0; col < w; col++) if(rows[row] & (0x80 >> col)) set_pixel(x + col, y + row, c);
+    }
+  }
+  void draw_line(int x0, int y0, int x1, int y1, char c) {
+    if(x0 == x1) draw_column(x0, y0, y1, c);
+    else draw_row(y0, x0, x1, c);  // draft.cpp draws no diagonals
+  }
+  void draw_row(int line, int x0, int x1, char c) {
+    if(x0 == x1){ set_pixel(x0, line, c); return; }
+    if(x0 > x1){ int t = x0; x0 = x1; x1 = t; }
+    for(int x = x0; x < x1; x++) set_pixel(x, line, c);
+  }
+  void draw_column(int column, int y0, int y1, char c) {
+    if(y0 > y1){ int t = y0; y0 = y1; y1 = t; }
+    for(int y = y0; y <= y1; y++) set_pixel(column, y, c);
+  }
+};
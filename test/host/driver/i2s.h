@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+typedef int esp_err_t;
+typedef enum { I2S_NUM_0 = 0, I2S_NUM_1 = 1 } i2s_port_t;
+typedef enum { I2S_MODE_MASTER = 1, I2S_MODE_TX = 4, I2S_MODE_DAC_BUILT_IN = 16 } i2s_mode_t;
+typedef enum { I2S_BITS_PER_SAMPLE_16BIT = 16 } i2s_bits_per_sample_t;
+typedef enum { I2S_CHANNEL_FMT_RIGHT_LEFT = 0, I2S_CHANNEL_FMT_ONLY_RIGHT = 3 } i2s_channel_fmt_t;
+typedef enum { I2S_COMM_FORMAT_STAND_MSB = 3 } i2s_comm_format_t;
+typedef enum { I2S_DAC_CHANNEL_RIGHT_EN = 1, I2S_DAC_CHANNEL_LEFT_EN = 2, I2S_DAC_CHANNEL_BOTH_EN = 3 } i2s_dac_mode_t;
+typedef struct { i2s_mode_t mode; uint32_t sample_rate; i2s_bits_per_sample_t bits_per_sample; i2s_channel_fmt_t channel_format; i2s_comm_format_t communication_format; int intr_alloc_flags; int dma_buf_count; int dma_buf_len; bool use_apll; bool tx_desc_auto_clear; int fixed_mclk; } i2s_config_t;
+typedef struct i2s_pin_config i2s_pin_config_t;
+inline esp_err_t i2s_driver_install(i2s_port_t, const i2s_config_t*, int, void*) { return 0; }
+inline esp_err_t i2s_set_pin(i2s_port_t, const i2s_pin_config_t*) { return 0; }
+inline esp_err_t i2s_set_dac_mode(i2s_dac_mode_t) { return 0; }
+inline esp_err_t i2s_write(i2s_port_t, const void*, size_t len, size_t *written, uint32_t) { *written = len; return 0; }
@@ -0,0 +1,104 @@
+// Host stand-in for TVout's fontALL.h: font4x6 in TVout's layout (width,
+// height, first character, then one byte per glyph row, leftmost pixel in
+// the top bit). The glyphs are not the real shapes, only distinct per
+// character, which is all the screen comparisons need.
+#pragma once
+const unsigned char font4x6[] = {
+  4, 6, 32,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xE0, 0xA0, 0x60, 0xA0, 0xE0, 0x00,
+  0xE0, 0x20, 0x80, 0x60, 0x60, 0x00,
+  0xA0, 0x20, 0x20, 0xA0, 0xA0, 0x00,
+  0xA0, 0x80, 0xE0, 0xC0, 0x20, 0x00,
+  0x60, 0x80, 0xC0, 0x80, 0x60, 0x00,
+  0x60, 0x00, 0x20, 0x40, 0xE0, 0x00,
+  0x20, 0x00, 0x80, 0x80, 0x20, 0x00,
+  0x60, 0xE0, 0x00, 0xA0, 0xE0, 0x00,
+  0xA0, 0xE0, 0x20, 0xE0, 0xA0, 0x00,
+  0xA0, 0x60, 0xC0, 0x20, 0x20, 0x00,
+  0xE0, 0x60, 0x60, 0xE0, 0xE0, 0x00,
+  0xE0, 0xC0, 0xA0, 0x80, 0x60, 0x00,
+  0x20, 0xC0, 0x80, 0xC0, 0x20, 0x00,
+  0x20, 0x40, 0x60, 0x00, 0xA0, 0x00,
+  0x60, 0x40, 0xC0, 0xC0, 0x60, 0x00,
+  0xA0, 0x20, 0xC0, 0x60, 0x20, 0x00,
+  0x60, 0x20, 0xE0, 0x20, 0x60, 0x00,
+  0x60, 0xA0, 0x00, 0xE0, 0xE0, 0x00,
+  0x20, 0xA0, 0xA0, 0x20, 0x20, 0x00,
+  0x20, 0x00, 0x60, 0x40, 0xA0, 0x00,
+  0xE0, 0x00, 0x40, 0x00, 0xE0, 0x00,
+  0xE0, 0x80, 0xA0, 0xC0, 0x60, 0x00,
+  0xA0, 0x80, 0x00, 0x00, 0xA0, 0x00,
+  0xE0, 0x60, 0x80, 0x20, 0x60, 0x00,
+  0x20, 0x60, 0xA0, 0x60, 0x20, 0x00,
+  0x20, 0xE0, 0x40, 0xA0, 0xA0, 0x00,
+  0x60, 0xE0, 0xE0, 0x60, 0x60, 0x00,
+  0x60, 0x40, 0x20, 0x00, 0xE0, 0x00,
+  0xA0, 0x40, 0x00, 0x40, 0xA0, 0x00,
+  0xA0, 0xC0, 0xE0, 0x80, 0x20, 0x00,
+  0xE0, 0xC0, 0x40, 0x40, 0xE0, 0x00,
+  0x20, 0xA0, 0x40, 0xE0, 0xA0, 0x00,
+  0xE0, 0xA0, 0x60, 0xA0, 0xE0, 0x00,
+  0xE0, 0x20, 0x80, 0x60, 0x60, 0x00,
+  0xA0, 0x20, 0x20, 0xA0, 0xA0, 0x00,
+  0xA0, 0x80, 0xE0, 0xC0, 0x20, 0x00,
+  0x60, 0x80, 0xC0, 0x80, 0x60, 0x00,
+  0x60, 0x00, 0x20, 0x40, 0xE0, 0x00,
+  0x20, 0x00, 0x80, 0x80, 0x20, 0x00,
+  0x60, 0xE0, 0x00, 0xA0, 0xE0, 0x00,
+  0xA0, 0xE0, 0x20, 0xE0, 0xA0, 0x00,
+  0xA0, 0x60, 0xC0, 0x20, 0x20, 0x00,
+  0xE0, 0x60, 0x60, 0xE0, 0xE0, 0x00,
+  0xE0, 0xC0, 0xA0, 0x80, 0x60, 0x00,
+  0x20, 0xC0, 0x80, 0xC0, 0x20, 0x00,
+  0x20, 0x40, 0x60, 0x00, 0xA0, 0x00,
+  0x60, 0x40, 0xC0, 0xC0, 0x60, 0x00,
+  0xA0, 0x20, 0xC0, 0x60, 0x20, 0x00,
+  0x60, 0x20, 0xE0, 0x20, 0x60, 0x00,
+  0x60, 0xA0, 0x00, 0xE0, 0xE0, 0x00,
+  0x20, 0xA0, 0xA0, 0x20, 0x20, 0x00,
+  0x20, 0x00, 0x60, 0x40, 0xA0, 0x00,
+  0xE0, 0x00, 0x40, 0x00, 0xE0, 0x00,
+  0xE0, 0x80, 0xA0, 0xC0, 0x60, 0x00,
+  0xA0, 0x80, 0x00, 0x00, 0xA0, 0x00,
+  0xE0, 0x60, 0x80, 0x20, 0x60, 0x00,
+  0x20, 0x60, 0xA0, 0x60, 0x20, 0x00,
+  0x20, 0xE0, 0x40, 0xA0, 0xA0, 0x00,
+  0x60, 0xE0, 0xE0, 0x60, 0x60, 0x00,
+  0x60, 0x40, 0x20, 0x00, 0xE0, 0x00,
+  0xA0, 0x40, 0x00, 0x40, 0xA0, 0x00,
+  0xA0, 0xC0, 0xE0, 0x80, 0x20, 0x00,
+  0xE0, 0xC0, 0x40, 0x40, 0xE0, 0x00,
+  0x20, 0xA0, 0x40, 0xE0, 0xA0, 0x00,
+  0xE0, 0xA0, 0x60, 0xA0, 0xE0, 0x00,
+  0xE0, 0x20, 0x80, 0x60, 0x60, 0x00,
+  0xA0, 0x20, 0x20, 0xA0, 0xA0, 0x00,
+  0xA0, 0x80, 0xE0, 0xC0, 0x20, 0x00,
+  0x60, 0x80, 0xC0, 0x80, 0x60, 0x00,
+  0x60, 0x00, 0x20, 0x40, 0xE0, 0x00,
+  0x20, 0x00, 0x80, 0x80, 0x20, 0x00,
+  0x60, 0xE0, 0x00, 0xA0, 0xE0, 0x00,
+  0xA0, 0xE0, 0x20, 0xE0, 0xA0, 0x00,
+  0xA0, 0x60, 0xC0, 0x20, 0x20, 0x00,
+  0xE0, 0x60, 0x60, 0xE0, 0xE0, 0x00,
+  0xE0, 0xC0, 0xA0, 0x80, 0x60, 0x00,
+  0x20, 0xC0, 0x80, 0xC0, 0x20, 0x00,
+  0x20, 0x40, 0x60, 0x00, 0xA0, 0x00,
+  0x60, 0x40, 0xC0, 0xC0, 0x60, 0x00,
+  0xA0, 0x20, 0xC0, 0x60, 0x20, 0x00,
+  0x60, 0x20, 0xE0, 0x20, 0x60, 0x00,
+  0x60, 0xA0, 0x00, 0xE0, 0xE0, 0x00,
+  0x20, 0xA0, 0xA0, 0x20, 0x20, 0x00,
+  0x20, 0x00, 0x60, 0x40, 0xA0, 0x00,
+  0xE0, 0x00, 0x40, 0x00, 0xE0, 0x00,
+  0xE0, 0x80, 0xA0, 0xC0, 0x60, 0x00,
+  0xA0, 0x80, 0x00, 0x00, 0xA0, 0x00,
+  0xE0, 0x60, 0x80, 0x20, 0x60, 0x00,
+  0x20, 0x60, 0xA0, 0x60, 0x20, 0x00,
+  0x20, 0xE0, 0x40, 0xA0, 0xA0, 0x00,
+  0x60, 0xE0, 0xE0, 0x60, 0x60, 0x00,
+  0x60, 0x40, 0x20, 0x00, 0xE0, 0x00,
+  0xA0, 0x40, 0x00, 0x40, 0xA0, 0x00,
+  0xA0, 0xC0, 0xE0, 0x80, 0x20, 0x00,
+  0xE0, 0xC0, 0x40, 0x40, 0xE0, 0x00
+};
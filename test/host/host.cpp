@@ -0,0 +1,289 @@
+// Definitions behind the host headers.
+#include "Arduino.h"
+#include "CompositeGraphics.h"
+#include "esp_system.h"
+#include "esp_partition.h"
+#include "esp_heap_caps.h"
+#include <new>
+#include "driver/spi_master.h"
+#include <chrono>
+#include <deque>
+
+uint64_t hostMicros = 0;
+int hostPins[64];
+int hostAnalog[64];
+int hostRestarts = 0;
+int hostNotifies = 0;
+size_t hostPrintfMax = 0;
+void (*hostTimerIsr)() = nullptr;
+bool hostTimerEnabled = false;
+uint64_t hostTimerAlarm = 0;
+uint32_t hostLedcDuty = 0;
+double hostLedcFreq = 0;
+void (*hostPinIsr[64])();
+FILE *hostConsoleOut = stderr;
+FILE *hostTelemetryOut = stdout;
+
+HardwareSerial Serial(hostConsoleOut);
+HardwareSerial Serial2(hostTelemetryOut);
+EspClass ESP;
+
+void HardwareSerial::printf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int length = vfprintf(out, format, args);
+  va_end(args);
+  if(length > 0 && (size_t)length > hostPrintfMax) hostPrintfMax = length;
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+// Every read moves the clock on a microsecond, so busy-wait loops end.
+unsigned long millis() { return (unsigned long)(++hostMicros / 1000); }
+unsigned long micros() { return (unsigned long)++hostMicros; }
+void delay(unsigned long ms) { hostAdvanceMs(ms); }
+void delayMicroseconds(unsigned us) { hostMicros += us; }
+int digitalRead(int pin) { return hostPins[pin]; }
+void digitalWrite(int pin, int value) { hostPins[pin] = value; }
+void pinMode(int, int) {}
+int analogRead(int pin) { return hostAnalog[pin]; }
+void attachInterrupt(int pin, void (*isr)(), int) { hostPinIsr[pin] = isr; }
+void noInterrupts() {}
+void interrupts() {}
+uint32_t getCpuFrequencyMhz() { return 240; }
+
+char *itoa(int value, char *out, int base) {
+  if(base == 16) sprintf(out, "%x", value);
+  else sprintf(out, "%d", value);
+  return out;
+}
+
+void esp_restart() {
+  hostRestarts++;
+  throw HostRestart();
+}
+void EspClass::restart() { esp_restart(); }
+uint32_t EspClass::getCycleCount() {
+  auto ns = std::chrono::steady_clock::now().time_since_epoch() / std::chrono::nanoseconds(1);
+  return (uint32_t)(ns * 240 / 1000);
+}
+
+hw_timer_t *timerBegin(uint8_t, uint16_t, bool) { return nullptr; }
+void timerAttachInterrupt(hw_timer_t *, void (*isr)(), bool) { hostTimerIsr = isr; }
+void timerAlarmWrite(hw_timer_t *, uint64_t ticks, bool) { hostTimerAlarm = ticks; }
+void timerAlarmEnable(hw_timer_t *) { hostTimerEnabled = true; }
+void timerAlarmDisable(hw_timer_t *) { hostTimerEnabled = false; }
+double ledcSetup(uint8_t, double freq, uint8_t) { return freq; }
+void ledcAttachPin(uint8_t, uint8_t) {}
+void ledcWrite(uint8_t, uint32_t duty) { hostLedcDuty = duty; }
+double ledcWriteTone(uint8_t, double freq) { return hostLedcFreq = freq; }
+
+static int hostTask;
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+BaseType_t xTaskNotifyGive(TaskHandle_t) {
+  hostNotifies++;
+  return pdPASS;
+}
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *) {}
+BaseType_t xTaskCreatePinnedToCore(void (*)(void *), const char *, uint32_t, void *, UBaseType_t,
+                                   TaskHandle_t *handle, BaseType_t) {
+  if(handle) *handle = &hostTask;
+  return pdPASS;
+}
+void vTaskDelay(TickType_t ticks) { hostAdvanceMs(ticks); }
+TickType_t xTaskGetTickCount() { return millis(); }
+TaskHandle_t xTaskGetCurrentTaskHandle() { return &hostTask; }
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 1024; }
+void enableLoopWDT() {}
+void feedLoopWDT() {}
+
+CompositeGraphics::CompositeGraphics(CompositeVideo::Mode, int width, int height)
+  : width(width), height(height) {
+  backbuffer = new char *[height];
+  for(int y = 0; y < height; y++) backbuffer[y] = new char[width]();
+}
+
+void CompositeGraphics::fillRect(int x, int y, int w, int h, uint16_t color) {
+  for(int py = max(y, 0); py < min(y + h, height); py++){
+    for(int px = max(x, 0); px < min(x + w, width); px++) backbuffer[py][px] = color;
+  }
+}
+
+void CompositeGraphics::drawRect(int x, int y, int w, int h, uint16_t color) {
+  fillRect(x, y, w, 1, color);
+  fillRect(x, y + h - 1, w, 1, color);
+  fillRect(x, y, 1, h, color);
+  fillRect(x + w - 1, y, 1, h, color);
+}
+
+void CompositeGraphics::drawBitmap(int x, int y, const unsigned char *bitmap, int w, int h, uint16_t color) {
+  for(int row = 0; row < h; row++){
+    for(int col = 0; col < w; col++){
+      if(bitmap[row * (w / 8) + col / 8] & (0x80 >> (col & 7))) fillRect(x + col, y + row, 1, 1, color);
+    }
+  }
+}
+
+void CompositeGraphics::print(const char *text) {
+  for(; *text; text++, cursorX += 8){
+    if(*text != ' ') fillRect(cursorX, cursorY, 5, 7, hue);
+  }
+}
+void CompositeGraphics::print(int value) { print(String(value)); }
+void CompositeGraphics::print(const String &text) { print(text.c_str()); }
+
+size_t hostHeapUsed = 0;
+size_t hostHeapPeak = 0;
+unsigned long hostHeapAllocs = 0;
+
+// Each block carries its size in front so a free can be counted back.
+union HostBlock { size_t size; max_align_t align; };
+
+static void *hostAlloc(size_t size) {
+  if(size > hostHeapBytes - hostHeapUsed) return nullptr;
+  HostBlock *block = (HostBlock *)malloc(sizeof(HostBlock) + size);
+  if(!block) return nullptr;
+  block->size = size;
+  hostHeapUsed += size;
+  if(hostHeapUsed > hostHeapPeak) hostHeapPeak = hostHeapUsed;
+  hostHeapAllocs++;
+  return block + 1;
+}
+
+static void hostFree(void *p) {
+  if(!p) return;
+  HostBlock *block = (HostBlock *)p - 1;
+  hostHeapUsed -= block->size;
+  free(block);
+}
+
+void *heap_caps_malloc(size_t size, uint32_t) { return hostAlloc(size); }
+void *heap_caps_calloc(size_t n, size_t size, uint32_t) {
+  void *p = hostAlloc(n * size);
+  if(p) memset(p, 0, n * size);
+  return p;
+}
+void heap_caps_free(void *p) { hostFree(p); }
+size_t heap_caps_get_free_size(uint32_t) { return hostHeapBytes - hostHeapUsed; }
+size_t heap_caps_get_minimum_free_size(uint32_t) { return hostHeapBytes - hostHeapPeak; }
+size_t heap_caps_get_largest_free_block(uint32_t) { return hostHeapBytes - hostHeapUsed; }
+
+// String and the host stubs allocate through these, as String does
+// through malloc on the chip.
+void *operator new(size_t size) {
+  void *p = hostAlloc(size);
+  if(!p) throw std::bad_alloc();
+  return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { hostFree(p); }
+void operator delete[](void *p) noexcept { hostFree(p); }
+void operator delete(void *p, size_t) noexcept { hostFree(p); }
+void operator delete[](void *p, size_t) noexcept { hostFree(p); }
+
+uint8_t hostFlash[hostFlashBytes];
+bool hostFlashPresent = false;
+int hostFlashFailWrites = 0;
+static const esp_partition_t hostPartition = { 0x3F0000, hostFlashBytes };
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t, const char *) {
+  return hostFlashPresent ? &hostPartition : nullptr;
+}
+esp_err_t esp_partition_read(const esp_partition_t *, size_t offset, void *out, size_t size) {
+  if(offset + size > hostFlashBytes) return ESP_FAIL;
+  memcpy(out, hostFlash + offset, size);
+  return ESP_OK;
+}
+esp_err_t esp_partition_write(const esp_partition_t *, size_t offset, const void *data, size_t size) {
+  if(offset + size > hostFlashBytes) return ESP_FAIL;
+  bool fail = hostFlashFailWrites > 0;
+  if(fail){
+    hostFlashFailWrites--;
+    size /= 2;
+  }
+  for(size_t i = 0; i < size; i++) hostFlash[offset + i] &= ((const uint8_t *)data)[i];
+  return fail ? ESP_FAIL : ESP_OK;
+}
+esp_err_t esp_partition_erase_range(const esp_partition_t *, size_t offset, size_t size) {
+  if(offset % 4096 || size % 4096 || offset + size > hostFlashBytes) return ESP_FAIL;
+  memset(hostFlash + offset, 0xFF, size);
+  return ESP_OK;
+}
+
+uint16_t hostPanel[hostPanelHeight][hostPanelWidth];
+HostPanelWrite hostPanelWrites[256];
+int hostPanelWriteCount = 0;
+unsigned long hostSpiBytes = 0;
+int hostSpiDcPin = -1;
+int hostSpiQueued = 0;
+
+static spi_device_interface_config_t hostSpiConfig;
+static std::deque<spi_transaction_t *> hostSpiQueue;
+static uint8_t panelCommand;
+static uint8_t panelArgs[4];
+static int panelArgCount, panelX0, panelX1, panelY0, panelY1, panelX, panelY, panelHigh = -1;
+
+static void panelData(uint8_t byte) {
+  if(panelCommand == 0x2A || panelCommand == 0x2B){
+    if(panelArgCount < 4) panelArgs[panelArgCount++] = byte;
+    if(panelArgCount < 4) return;
+    int from = panelArgs[0] << 8 | panelArgs[1], to = panelArgs[2] << 8 | panelArgs[3];
+    if(panelCommand == 0x2A){ panelX0 = from; panelX1 = to; }
+    else                    { panelY0 = from; panelY1 = to; }
+  } else if(panelCommand == 0x2C){
+    hostPanelWrites[(hostPanelWriteCount - 1) & 255].bytes++;
+    if(panelHigh < 0){ panelHigh = byte; return; }
+    if(panelX < hostPanelWidth && panelY < hostPanelHeight) hostPanel[panelY][panelX] = panelHigh << 8 | byte;
+    panelHigh = -1;
+    if(++panelX > panelX1){ panelX = panelX0; panelY++; }
+  }
+}
+
+static void panelCommandByte(uint8_t cmd) {
+  panelCommand = cmd;
+  panelArgCount = 0;
+  panelHigh = -1;
+  if(cmd == 0x2C){
+    panelX = panelX0;
+    panelY = panelY0;
+    hostPanelWrites[hostPanelWriteCount++ & 255] = { panelX0, panelY0, panelX1, panelY1, 0 };
+  }
+}
+
+static void runTransaction(spi_transaction_t *t) {
+  if(hostSpiConfig.pre_cb) hostSpiConfig.pre_cb(t);
+  const uint8_t *data = (t->flags & SPI_TRANS_USE_TXDATA) ? t->tx_data : (const uint8_t *)t->tx_buffer;
+  size_t bytes = t->length / 8;
+  hostSpiBytes += bytes;
+  if(hostSpiDcPin < 0) return;
+  for(size_t i = 0; i < bytes; i++){
+    if(hostPins[hostSpiDcPin]) panelData(data[i]);
+    else panelCommandByte(data[i]);
+  }
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t, const spi_bus_config_t *, int) { return ESP_OK; }
+esp_err_t spi_bus_add_device(spi_host_device_t, const spi_device_interface_config_t *config,
+                             spi_device_handle_t *handle) {
+  hostSpiConfig = *config;
+  *handle = (spi_device_handle_t)&hostSpiConfig;
+  return ESP_OK;
+}
+esp_err_t spi_device_polling_transmit(spi_device_handle_t, spi_transaction_t *t) {
+  runTransaction(t);
+  return ESP_OK;
+}
+esp_err_t spi_device_queue_trans(spi_device_handle_t, spi_transaction_t *t, uint32_t) {
+  hostSpiQueue.push_back(t);
+  hostSpiQueued = hostSpiQueue.size();
+  return ESP_OK;
+}
+esp_err_t spi_device_get_trans_result(spi_device_handle_t, spi_transaction_t **done, uint32_t) {
+  if(hostSpiQueue.empty()) return ESP_ERR_TIMEOUT;
+  *done = hostSpiQueue.front();
+  hostSpiQueue.pop_front();
+  hostSpiQueued = hostSpiQueue.size();
+  runTransaction(*done);
+  return ESP_OK;
+}
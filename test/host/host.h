@@ -0,0 +1,58 @@
+// Controls for tests driving the sketch on the host.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+extern uint64_t hostMicros;      // the clock millis() and micros() read
+extern int hostPins[64];         // digitalRead()/digitalWrite()
+extern int hostAnalog[64];       // analogRead()
+extern int hostRestarts;         // esp_restart() calls
+extern int hostNotifies;         // xTaskNotifyGive() calls
+extern size_t hostPrintfMax;     // longest output of one Serial.printf() call
+extern FILE *hostConsoleOut;     // Serial
+extern FILE *hostTelemetryOut;   // Serial2
+
+// Hardware timer (one is enough for the sketch) and LEDC channel 0.
+extern void (*hostTimerIsr)();   // timerAttachInterrupt()
+extern bool hostTimerEnabled;    // timerAlarmEnable()/timerAlarmDisable()
+extern uint64_t hostTimerAlarm;  // timerAlarmWrite(), in timer ticks
+extern uint32_t hostLedcDuty;    // last ledcWrite()
+extern double hostLedcFreq;      // last ledcWriteTone()
+
+// TFT panel on the SPI bus, as it would be after every transaction the
+// sketch has collected: CASET/RASET set the window, RAMWR fills it with
+// RGB565 (as sent, high byte first). The DC line is read from hostPins.
+const int hostPanelWidth = 320, hostPanelHeight = 240;
+struct HostPanelWrite { int x0, y0, x1, y1; size_t bytes; };  // one RAMWR, inclusive window
+extern uint16_t hostPanel[hostPanelHeight][hostPanelWidth];
+extern HostPanelWrite hostPanelWrites[256];  // RAMWRs since the count was cleared
+extern int hostPanelWriteCount;
+extern unsigned long hostSpiBytes;   // bytes clocked out, commands included
+extern int hostSpiDcPin;             // -1 = no panel model
+extern int hostSpiQueued;            // queued, not yet collected
+
+// The one flash partition, as NOR flash: an erase sets bytes to 0xFF and
+// programming can only clear bits. A failing write programs the first
+// half of its data and returns ESP_FAIL, as a torn program would.
+const size_t hostFlashBytes = 8192;
+extern uint8_t hostFlash[hostFlashBytes];
+extern bool hostFlashPresent;     // esp_partition_find_first() finds it
+extern int hostFlashFailWrites;   // the next this many writes fail
+
+// Heap model behind esp_heap_caps.h.
+const size_t hostHeapBytes = 200000;
+extern size_t hostHeapUsed;         // live bytes
+extern size_t hostHeapPeak;         // most live bytes at once
+extern unsigned long hostHeapAllocs;  // allocations so far
+
+// Pin interrupts from attachInterrupt(), by pin.
+extern void (*hostPinIsr[64])();
+
+// Thrown by esp_restart(): on the target it never returns.
+struct HostRestart {};
+
+inline void hostAdvanceMs(unsigned long ms) { hostMicros += (uint64_t)ms * 1000; }
+
+// Fires the timer interrupt once, as the alarm would, if it is enabled.
+inline void hostTimerTick() { if(hostTimerEnabled && hostTimerIsr) hostTimerIsr(); }
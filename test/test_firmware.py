@@ -0,0 +1,44 @@
+"""Runs the host checks of the sketches themselves: firmware_test.cpp,
+tft_test.cpp (color.cpp with the SPI TFT on), attr_test.cpp (color.cpp
+with ATTR_VIDEO), dual_test.cpp (with DUAL_VIDEO too) and draft_test.cpp
+(draft.cpp on the host TVout).
+
+    python3 -m unittest discover test
+"""
+
+import shutil
+import subprocess
+import tempfile
+import unittest
+
+from test_tools import build
+
+
+class FirmwareTest(unittest.TestCase):
+    def run_checks(self, source):
+        work = tempfile.mkdtemp()
+        try:
+            result = subprocess.run([build(work, source)], stderr=subprocess.PIPE,
+                                    stdout=subprocess.DEVNULL, timeout=60)
+        finally:
+            shutil.rmtree(work)
+        self.assertEqual(result.returncode, 0, result.stderr.decode())
+
+    def test_firmware_checks(self):
+        self.run_checks("firmware_test.cpp")
+
+    def test_tft_checks(self):
+        self.run_checks("tft_test.cpp")
+
+    def test_attr_video_checks(self):
+        self.run_checks("attr_test.cpp")
+
+    def test_dual_video_checks(self):
+        self.run_checks("dual_test.cpp")
+
+    def test_draft_checks(self):
+        self.run_checks("draft_test.cpp")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,175 @@
+"""Tests for the host tools in tools/, fed by the real firmware encoder.
+
+emit_stream.cpp runs color.cpp on the host (test/host) and writes its
+telemetry stream; the tests play that stream into a pty and run the
+command lines on the pty's slave end, as they would on a serial port.
+
+    python3 -m unittest discover test
+"""
+
+import json
+import os
+import pty
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import tty
+import unittest
+import zlib
+
+TEST_DIR = os.path.dirname(os.path.abspath(__file__))
+TOOLS_DIR = os.path.join(os.path.dirname(TEST_DIR), "tools")
+sys.path.insert(0, TOOLS_DIR)
+
+import dashlink  # noqa: E402
+import draft_sram  # noqa: E402
+
+
+def build(work, source):
+    binary = os.path.join(work, os.path.splitext(source)[0])
+    subprocess.check_call(["g++", "-std=gnu++11", "-Wall", "-pthread", "-I", os.path.join(TEST_DIR, "host"),
+                           "-o", binary, os.path.join(TEST_DIR, source),
+                           os.path.join(TEST_DIR, "host", "host.cpp")])
+    return binary
+
+
+def run_on_pty(stream, tool, *args):
+    """Runs a tool on a pty slave while the stream is written to the master."""
+    master, slave = pty.openpty()
+    tty.setraw(slave)
+    proc = subprocess.Popen([sys.executable, os.path.join(TOOLS_DIR, tool), os.ttyname(slave)]
+                            + list(args), stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+
+    def feed():
+        for i in range(0, len(stream), 1000):
+            os.write(master, stream[i:i + 1000])
+
+    writer = threading.Thread(target=feed)
+    writer.start()
+    out, err = proc.communicate(timeout=60)
+    os.close(master)
+    writer.join()
+    os.close(slave)
+    return proc.returncode, out.decode(), err.decode()
+
+
+def read_png(path):
+    """Returns (width, height, rgb bytes) of a PNG written by dashlink."""
+    with open(path, "rb") as png:
+        data = png.read()[8:]
+    idat = b""
+    while data:
+        length, tag = struct.unpack(">I4s", data[:8])
+        body, data = data[8:8 + length], data[12 + length:]
+        if tag == b"IHDR":
+            width, height = struct.unpack(">II", body[:8])
+        elif tag == b"IDAT":
+            idat += body
+    rows = zlib.decompress(idat)
+    stride = width * 3 + 1
+    return width, height, b"".join(rows[y * stride + 1:(y + 1) * stride] for y in range(height))
+
+
+class ToolsTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.work = tempfile.mkdtemp()
+        emit = build(cls.work, "emit_stream.cpp")
+        expect = os.path.join(cls.work, "expect.txt")
+        shadow = os.path.join(cls.work, "shadow.bin")
+        cls.stream = subprocess.run([emit, expect, shadow], stdout=subprocess.PIPE,
+                                    stderr=subprocess.DEVNULL, check=True).stdout
+        with open(expect) as lines:
+            cls.expected = [tuple(map(int, line.split())) for line in lines]
+        with open(shadow, "rb") as raw:
+            cls.shadow = raw.read()
+        cls.packets = list(dashlink.FrameReader().feed(cls.stream))
+
+    @classmethod
+    def tearDownClass(cls):
+        shutil.rmtree(cls.work)
+
+    def count(self, kind):
+        return sum(1 for k, _ in self.packets if k == kind)
+
+    def test_decoder_matches_firmware(self):
+        snaps = [dashlink.parse_snapshot(p) for k, p in self.packets if k == dashlink.PKT_SNAPSHOT]
+        self.assertEqual(len(snaps), len(self.expected))
+        for snap, (seq, coolant, fuel, oil) in zip(snaps, self.expected):
+            self.assertEqual((snap["seq"], snap["coolant_c"], snap["fuel_liters"]),
+                             (seq, coolant, fuel))
+            self.assertEqual("oil_critical" in snap["alarms"], bool(oil))
+        self.assertGreater(self.count(dashlink.PKT_MEMORY), 0)
+
+    def test_resyncs_after_corrupt_frame(self):
+        corrupt = bytearray(self.stream)
+        corrupt[5] ^= 0x40  # inside the first frame
+        reader = dashlink.FrameReader()
+        packets = list(reader.feed(bytes(corrupt)))
+        self.assertEqual(reader.bad, 1)
+        self.assertEqual(packets, self.packets[1:])
+
+    def test_frames_split_across_reads(self):
+        reader = dashlink.FrameReader()
+        packets = []
+        for i in range(0, len(self.stream), 7):
+            packets += reader.feed(self.stream[i:i + 7])
+        self.assertEqual(packets, self.packets)
+
+    def test_telemetry_cli_on_pty(self):
+        records = self.count(dashlink.PKT_SNAPSHOT) + self.count(dashlink.PKT_MEMORY)
+        code, out, err = run_on_pty(self.stream, "telemetry.py", "--jsonl",
+                                    "--count", str(records))
+        self.assertEqual(code, 0, err)
+        lines = [json.loads(line) for line in out.splitlines()]
+        snaps = [line for line in lines if line["type"] == "snapshot"]
+        self.assertEqual(len(lines), records)
+        self.assertEqual([(s["seq"], s["coolant_c"], s["fuel_liters"]) for s in snaps],
+                         [e[:3] for e in self.expected])
+        self.assertIn("0 bad", err)
+
+    def test_mirror_matches_firmware_shadow(self):
+        mirror = dashlink.Mirror()
+        frames = sum(mirror.apply(k, p) for k, p in self.packets)
+        self.assertEqual(frames, self.count(dashlink.PKT_MIRROR_FRAME))
+        self.assertEqual(bytes(mirror.pixels), self.shadow)
+
+    def test_mirror_view_on_pty(self):
+        out = os.path.join(self.work, "frames")
+        frames = self.count(dashlink.PKT_MIRROR_FRAME)
+        code, _, err = run_on_pty(self.stream, "mirror_view.py", "--out", out, "--raw",
+                                  "--scale", "1", "--count", str(frames))
+        self.assertEqual(code, 0, err)
+        last = os.path.join(out, "frame-%05d" % frames)
+        with open(last + ".raw", "rb") as raw:
+            self.assertEqual(raw.read(), self.shadow)
+        width, height, rgb = read_png(last + ".png")
+        self.assertEqual(width * height, len(self.shadow))
+        self.assertEqual(rgb, b"".join(bytes(dashlink.color_to_rgb(v)) for v in self.shadow))
+
+
+class DraftSramTest(unittest.TestCase):
+    # In the layout avr-size -A prints; the figures are made up.
+    REPORT = """draft.ino.elf  :
+section                     size      addr
+.data                         58   8388864
+.text                       5374         0
+.bss                         181   8388922
+.comment                      17         0
+.note.gnu.avr.deviceinfo      64         0
+.debug_info                 1524         0
+Total                       7218
+"""
+
+    def test_parses_avr_size(self):
+        sizes = draft_sram.parse_avr_size(self.REPORT)
+        self.assertEqual(sizes[".data"], 58)
+        self.assertEqual(sizes[".bss"], 181)
+        self.assertNotIn("Total", sizes)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,84 @@
+// Builds color.cpp with the SPI TFT on and plays every SPI transaction
+// it queues into the panel model (test/host): the picture on the panel
+// must be the dashboard, and only changed spans may be sent.
+// test_firmware.py builds and runs it.
+#define TFT_ENABLED true
+#include "../color.cpp"
+
+int failures = 0;
+
+#define CHECK(cond) do { \
+    if(!(cond)){ fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+  } while(0)
+
+// Runs tftFrame() until nothing is left to send or in flight.
+void settleTft() {
+  for(int i = 0; i < 1000; i++){
+    unsigned long sent = tftBytesSent;
+    tftFrame();
+    if(tftBytesSent == sent && hostSpiQueued == 0) return;
+  }
+  CHECK(!"tft never settled");
+}
+
+// The RGB565 the panel should show at (x, y): the scaled dashboard inside
+// the centered window, nothing ever written outside it.
+uint16_t expectedPixel(int x, int y) {
+  int sx = x - tftOriginX, sy = y - tftOriginY;
+  if(sx < 0 || sy < 0 || sx >= screenWidth * tftScale || sy >= screenHeight * tftScale) return 0;
+  uint16_t c = tftPalette[(uint8_t)frameRow(sy / tftScale)[sx / tftScale]];
+  return (uint16_t)(c << 8 | c >> 8);  // the table holds it byte-swapped for the DMA
+}
+
+int panelMismatches() {
+  int bad = 0;
+  for(int y = 0; y < hostPanelHeight; y++){
+    for(int x = 0; x < hostPanelWidth; x++) bad += hostPanel[y][x] != expectedPixel(x, y);
+  }
+  return bad;
+}
+
+void testPanelMatchesFramebuffer() {
+  settleTft();
+  CHECK(panelMismatches() == 0);
+  CHECK(hostPanelWriteCount > 0);
+}
+
+void testPartialUpdateSendsOnlyDirtySpan() {
+  settleTft();
+  const uint16_t color = graphics.backbuffer[20][10] == 7 ? 8 : 7;
+  graphics.fillRect(10, 20, 5, 3, color);  // inside strip 2 (rows 16..23)
+
+  unsigned long bytesBefore = tftBytesSent, spiBefore = hostSpiBytes;
+  hostPanelWriteCount = 0;
+  settleTft();
+
+  const int w = 5 * tftScale, h = tftStripRows * tftScale;
+  CHECK(tftBytesSent - bytesBefore == (unsigned long)(w * h * 2 + 3 + 2 * 4));
+  CHECK(hostSpiBytes - spiBefore == tftBytesSent - bytesBefore);
+  CHECK(hostPanelWriteCount == 1);
+  const HostPanelWrite &write = hostPanelWrites[0];
+  CHECK(write.x0 == tftOriginX + 10 * tftScale && write.x1 == write.x0 + w - 1);
+  CHECK(write.y0 == tftOriginY + 16 * tftScale && write.y1 == write.y0 + h - 1);
+  CHECK(write.bytes == (size_t)(w * h * 2));
+  CHECK(panelMismatches() == 0);
+
+  hostPanelWriteCount = 0;
+  settleTft();
+  CHECK(hostPanelWriteCount == 0);  // nothing changed since
+}
+
+int main() {
+  hostAnalog[coolantPin] = 500;
+  hostAnalog[fuelPin] = 500;
+  hostAnalog[ambientPin] = 2500;
+  hostConsoleOut = fopen("/dev/null", "w");
+  hostSpiDcPin = tftDcPin;
+  setup();
+
+  testPanelMatchesFramebuffer();
+  testPartialUpdateSendsOnlyDirtySpan();
+
+  if(failures) fprintf(stderr, "%d check(s) failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,209 @@
+"""Host side of the dashboard's telemetry link (color.cpp, "Telemetry").
+
+Frames arrive on the UART as COBS(type, payload..., crc_lo, crc_hi) 0x00,
+with CRC-16/CCITT-FALSE over type and payload and little-endian fields.
+FrameReader turns a byte stream into packets, resynchronising on the
+next 0x00 after a bad frame; the parse_* helpers and Mirror decode the
+packet types. telemetry.py and mirror_view.py are the command lines.
+"""
+
+import os
+import struct
+import termios
+import tty
+import zlib
+
+PKT_SNAPSHOT = 1
+PKT_MIRROR_KEY = 2
+PKT_MIRROR_TILE = 3
+PKT_MIRROR_FRAME = 4
+PKT_MEMORY = 5
+
+SNAPSHOT_FORMAT = "<HIHHHHHhhBBHHH"
+SNAPSHOT_FIELDS = ("seq", "time_us", "coolant_raw", "coolant_adc", "fuel_raw", "fuel_adc",
+                   "ambient_adc", "coolant_c", "fuel_liters", "flags", "page",
+                   "frame_time_us", "frame_max_us", "dropped")
+SNAPSHOT_FLAGS = {0x01: "oil_critical", 0x02: "coolant_critical", 0x04: "fuel_critical",
+                  0x08: "night", 0x10: "glow_on", 0x20: "tone_active"}
+
+MEMORY_FORMAT = "<IIIHHHHH"
+MEMORY_FIELDS = ("heap_free", "heap_min_free", "heap_largest_block", "arena_used", "arena_bytes",
+                 "stack_loop", "stack_watchdog", "stack_checkpoint")
+
+TILE_RAW = 0
+TILE_RLE = 1
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    """Decodes one frame without its 0x00 terminator; None if malformed."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+class FrameReader:
+    """Feeds raw bytes in, yields (type, payload) for every good frame."""
+
+    def __init__(self):
+        self.pending = bytearray()
+        self.good = 0
+        self.bad = 0
+
+    def feed(self, data):
+        self.pending += data
+        while True:
+            end = self.pending.find(0)
+            if end < 0:
+                return
+            frame = bytes(self.pending[:end])
+            del self.pending[:end + 1]
+            if not frame:
+                continue
+            packet = self._check(frame)
+            if packet is None:
+                self.bad += 1
+            else:
+                self.good += 1
+                yield packet
+
+    @staticmethod
+    def _check(frame):
+        raw = cobs_decode(frame)
+        if raw is None or len(raw) < 3:
+            return None
+        body, crc = raw[:-2], raw[-2] | raw[-1] << 8
+        if crc16(body) != crc:
+            return None
+        return body[0], body[1:]
+
+
+def parse_snapshot(payload):
+    snap = dict(zip(SNAPSHOT_FIELDS, struct.unpack(SNAPSHOT_FORMAT, payload)))
+    snap["alarms"] = [name for bit, name in sorted(SNAPSHOT_FLAGS.items()) if snap["flags"] & bit]
+    return snap
+
+
+def parse_memory(payload):
+    return dict(zip(MEMORY_FIELDS, struct.unpack(MEMORY_FORMAT, payload)))
+
+
+class Mirror:
+    """Rebuilds the dashboard frame (one color value per pixel) from
+    PKT_MIRROR_* packets. apply() returns True when a frame is complete."""
+
+    def __init__(self):
+        self.width = self.height = 0
+        self.tile_width = self.tile_height = 0
+        self.pixels = bytearray()
+        self.keyed = False
+
+    def apply(self, kind, payload):
+        if kind == PKT_MIRROR_KEY:
+            self.width, self.height, self.tile_width, self.tile_height = payload[:4]
+            self.pixels = bytearray(self.width * self.height)
+            self.keyed = True
+        elif kind == PKT_MIRROR_TILE and self.keyed:
+            self._apply_tile(payload[0], payload[1], payload[2:])
+        elif kind == PKT_MIRROR_FRAME and self.keyed:
+            return True
+        return False
+
+    def _apply_tile(self, tile, encoding, data):
+        if encoding == TILE_RLE:
+            delta = bytearray()
+            for i in range(0, len(data) - 1, 2):
+                delta += bytes([data[i + 1]]) * data[i]
+        else:
+            delta = data
+        tiles_x = self.width // self.tile_width
+        x0 = (tile % tiles_x) * self.tile_width
+        y0 = (tile // tiles_x) * self.tile_height
+        for row in range(self.tile_height):
+            start = (y0 + row) * self.width + x0
+            for col in range(self.tile_width):
+                self.pixels[start + col] ^= delta[row * self.tile_width + col]
+
+
+# Color values as the TFT shows them (color.cpp, buildTftPalette): UI
+# colors of both palettes have fixed looks, anything else is a hue.
+UI_COLORS = {10: (0, 0, 96), 40: (255, 255, 255), 2: (0, 0, 24), 20: (128, 128, 128)}
+
+
+def hue_to_rgb(hue):
+    hue %= 360
+    rise = (hue % 60) * 255 // 60
+    fall = 255 - rise
+    return [(255, rise, 0), (fall, 255, 0), (0, 255, rise),
+            (0, fall, 255), (rise, 0, 255), (255, 0, fall)][hue // 60]
+
+
+def color_to_rgb(value):
+    return UI_COLORS.get(value) or hue_to_rgb(value)
+
+
+def write_png(path, width, height, pixels, scale=1):
+    """Saves color values as an RGB PNG, each pixel scale x scale."""
+    palette = [color_to_rgb(v) for v in range(256)]
+    rows = bytearray()
+    for y in range(height):
+        line = bytearray()
+        for value in pixels[y * width:(y + 1) * width]:
+            line += bytes(palette[value]) * scale
+        rows += (b"\0" + line) * scale
+
+    def chunk(tag, data):
+        return (struct.pack(">I", len(data)) + tag + data
+                + struct.pack(">I", zlib.crc32(tag + data) & 0xFFFFFFFF))
+
+    header = struct.pack(">IIBBBBB", width * scale, height * scale, 8, 2, 0, 0, 0)
+    with open(path, "wb") as out:
+        out.write(b"\x89PNG\r\n\x1a\n" + chunk(b"IHDR", header)
+                  + chunk(b"IDAT", zlib.compress(bytes(rows))) + chunk(b"IEND", b""))
+
+
+BAUD_RATES = {115200: termios.B115200, 230400: termios.B230400, 460800: termios.B460800,
+              921600: termios.B921600}
+
+
+def open_stream(path, baud=921600):
+    """Opens a serial port, pty or capture file for reading. A tty is put
+    in raw mode at the given baud rate."""
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+    if os.isatty(fd):
+        tty.setraw(fd, termios.TCSANOW)
+        attrs = termios.tcgetattr(fd)
+        attrs[4] = attrs[5] = BAUD_RATES[baud]
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+def read_packets(fd, reader=None):
+    """Yields (type, payload) until end of stream. A pty whose other end
+    closed reads as EIO, which also ends the stream."""
+    reader = reader or FrameReader()
+    while True:
+        try:
+            data = os.read(fd, 4096)
+        except OSError:
+            return
+        if not data:
+            return
+        yield from reader.feed(data)
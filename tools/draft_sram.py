@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Builds draft.cpp at git revisions for the AVR and reports its static SRAM.
+
+    tools/draft_sram.py 6195bbb^ 6195bbb
+    tools/draft_sram.py HEAD --fqbn arduino:avr:nano
+
+Each revision's draft.cpp is compiled with arduino-cli (the TVout library
+installed) and avr-size -A reads .data and .bss from the ELF: .data holds
+the initialised globals, string literals included, copied into SRAM at
+startup. With two or more revisions the change against the first is
+printed too. Heap use at run time (String) is not in these figures.
+"""
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SECTIONS = (".data", ".bss")
+
+
+def parse_avr_size(text):
+    """Returns {section: bytes} from avr-size -A output."""
+    sizes = {}
+    for line in text.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0].startswith(".") and fields[1].isdigit():
+            sizes[fields[0]] = int(fields[1])
+    return sizes
+
+
+def measure(revision, fqbn, work):
+    sketch = os.path.join(work, revision.replace("^", "_").replace("~", "_").replace("/", "_"), "draft")
+    os.makedirs(sketch)
+    source = subprocess.check_output(["git", "-C", ROOT, "show", revision + ":draft.cpp"])
+    with open(os.path.join(sketch, "draft.ino"), "wb") as f:
+        f.write(source)
+    out = os.path.join(sketch, "build")
+    subprocess.check_call(["arduino-cli", "compile", "--fqbn", fqbn, "--output-dir", out, sketch],
+                          stdout=subprocess.DEVNULL)
+    report = subprocess.check_output(["avr-size", "-A", os.path.join(out, "draft.ino.elf")])
+    return parse_avr_size(report.decode())
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("revisions", nargs="+", help="git revisions to build")
+    parser.add_argument("--fqbn", default="arduino:avr:uno", help="board for arduino-cli")
+    args = parser.parse_args(argv)
+
+    for tool in ("arduino-cli", "avr-size"):
+        if not shutil.which(tool):
+            sys.exit("draft_sram: %s not found" % tool)
+
+    work = tempfile.mkdtemp()
+    try:
+        first = None
+        print("%-16s %8s %8s" % ("revision", ".data", ".bss"))
+        for revision in args.revisions:
+            sizes = measure(revision, args.fqbn, work)
+            row = [sizes.get(name, 0) for name in SECTIONS]
+            line = "%-16s %8d %8d" % (revision, row[0], row[1])
+            if first is None:
+                first = row
+            else:
+                line += "   %+d %+d" % (row[0] - first[0], row[1] - first[1])
+            print(line)
+    finally:
+        shutil.rmtree(work)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+"""Rebuilds the dashboard screen from its telemetry mirror and saves frames.
+
+    tools/mirror_view.py /dev/ttyUSB0 --out frames
+    tools/mirror_view.py capture.bin --out frames --scale 4 --raw
+
+A frame is saved on every PKT_MIRROR_FRAME, as frames/frame-NNNNN.png in
+the TFT's colors; --raw also saves the color values, one byte per pixel.
+Until the first PKT_MIRROR_KEY (every few seconds) nothing is saved.
+"""
+
+import argparse
+import os
+import sys
+
+import dashlink
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port, pty or capture file")
+    parser.add_argument("--baud", type=int, default=921600, choices=sorted(dashlink.BAUD_RATES))
+    parser.add_argument("--out", default="frames", help="directory for saved frames")
+    parser.add_argument("--scale", type=int, default=2, help="PNG pixels per screen pixel")
+    parser.add_argument("--count", type=int, default=0, help="stop after this many frames")
+    parser.add_argument("--raw", action="store_true", help="also save raw color values")
+    args = parser.parse_args(argv)
+
+    os.makedirs(args.out, exist_ok=True)
+    mirror = dashlink.Mirror()
+    reader = dashlink.FrameReader()
+    fd = dashlink.open_stream(args.port, args.baud)
+    saved = 0
+    try:
+        for kind, payload in dashlink.read_packets(fd, reader):
+            if not mirror.apply(kind, payload):
+                continue
+            saved += 1
+            base = os.path.join(args.out, "frame-%05d" % saved)
+            dashlink.write_png(base + ".png", mirror.width, mirror.height, mirror.pixels,
+                               args.scale)
+            if args.raw:
+                with open(base + ".raw", "wb") as raw:
+                    raw.write(mirror.pixels)
+            print("%s.png  %dx%d" % (base, mirror.width, mirror.height), flush=True)
+            if saved == args.count:
+                break
+    except KeyboardInterrupt:
+        pass
+    finally:
+        os.close(fd)
+    print("%d frames, %d good packets, %d bad" % (saved, reader.good, reader.bad),
+          file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""Prints the dashboard's telemetry snapshots and memory reports.
+
+    tools/telemetry.py /dev/ttyUSB0              one line per packet
+    tools/telemetry.py /dev/ttyUSB0 --jsonl      one JSON object per packet
+    tools/telemetry.py capture.bin --count 100
+
+Mirror packets are skipped; tools/mirror_view.py shows those. Bad frames
+are counted and reported on stderr when the stream ends.
+"""
+
+import argparse
+import json
+import os
+import sys
+
+import dashlink
+
+
+def format_snapshot(snap):
+    return ("#{seq:5d} {time_us:10d} us  coolant {coolant_c:4d} C ({coolant_adc:4d})  "
+            "fuel {fuel_liters:3d} l ({fuel_adc:4d})  page {page}  "
+            "frame {frame_time_us}/{frame_max_us} us  dropped {dropped}").format(**snap) + \
+        ("  " + ",".join(snap["alarms"]) if snap["alarms"] else "")
+
+
+def format_memory(mem):
+    return ("memory: heap {heap_free} (min {heap_min_free}, block {heap_largest_block})  "
+            "arena {arena_used}/{arena_bytes}  stack {stack_loop}/{stack_watchdog}/"
+            "{stack_checkpoint}").format(**mem)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port, pty or capture file")
+    parser.add_argument("--baud", type=int, default=921600, choices=sorted(dashlink.BAUD_RATES))
+    parser.add_argument("--count", type=int, default=0, help="stop after this many packets")
+    parser.add_argument("--jsonl", action="store_true", help="print JSON lines")
+    args = parser.parse_args(argv)
+
+    reader = dashlink.FrameReader()
+    fd = dashlink.open_stream(args.port, args.baud)
+    printed = 0
+    try:
+        for kind, payload in dashlink.read_packets(fd, reader):
+            if kind == dashlink.PKT_SNAPSHOT:
+                record = dashlink.parse_snapshot(payload)
+                line = format_snapshot(record)
+            elif kind == dashlink.PKT_MEMORY:
+                record = dashlink.parse_memory(payload)
+                line = format_memory(record)
+            else:
+                continue
+            if args.jsonl:
+                record["type"] = "snapshot" if kind == dashlink.PKT_SNAPSHOT else "memory"
+                line = json.dumps(record)
+            print(line, flush=True)
+            printed += 1
+            if printed == args.count:
+                break
+    except KeyboardInterrupt:
+        pass
+    finally:
+        os.close(fd)
+    print("%d good frames, %d bad" % (reader.good, reader.bad), file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())